@@ -0,0 +1,217 @@
+#include "AnimationRenderer.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace facebook::react {
+
+AttractorParameters
+interpolateKeyframes(const std::vector<AnimationKeyframe>& keyframes, int frame) {
+  if (keyframes.empty()) {
+    throw std::runtime_error("An animation needs at least one keyframe");
+  }
+
+  // The last keyframe at or before the frame, and the first one after it
+  const AnimationKeyframe* from = nullptr;
+  const AnimationKeyframe* to = nullptr;
+  for (const auto& keyframe : keyframes) {
+    if (keyframe.frame <= frame && (!from || keyframe.frame > from->frame)) {
+      from = &keyframe;
+    }
+    if (keyframe.frame > frame && (!to || keyframe.frame < to->frame)) {
+      to = &keyframe;
+    }
+  }
+  if (!from || !to) {
+    return (from ? from : to)->params;
+  }
+
+  double t = static_cast<double>(frame - from->frame) / (to->frame - from->frame);
+  auto mix = [t](double start, double end) { return start + (end - start) * t; };
+  AttractorParameters params = from->params;
+  params.a = mix(from->params.a, to->params.a);
+  params.b = mix(from->params.b, to->params.b);
+  params.c = mix(from->params.c, to->params.c);
+  params.d = mix(from->params.d, to->params.d);
+  params.hue = mix(from->params.hue, to->params.hue);
+  params.saturation = mix(from->params.saturation, to->params.saturation);
+  params.brightness = mix(from->params.brightness, to->params.brightness);
+  params.scale = mix(from->params.scale, to->params.scale);
+  params.left = mix(from->params.left, to->params.left);
+  params.top = mix(from->params.top, to->params.top);
+  return params;
+}
+
+// Frames per thread that may be rendered ahead of the writer
+const int kFramesAheadPerThread = 2;
+
+bool
+renderAnimation(
+  AttractorCore& core,
+  WorkerPool& pool,
+  const AnimationOptions& options,
+  const AnimationFrameWriter& write,
+  const std::shared_ptr<std::atomic<bool>>& cancelled
+) {
+  // Fails before any thread starts on an invalid attractor
+  for (const auto& keyframe : options.keyframes) {
+    AttractorCore::getAttractorType(keyframe.params.attractor);
+  }
+  if (options.keyframes.empty()) {
+    throw std::runtime_error("An animation needs at least one keyframe");
+  }
+  // The colouring takes the pixel count as an int
+  if (options.width <= 0 || options.height <= 0 ||
+      static_cast<int64_t>(options.width) * options.height > std::numeric_limits<int>::max()) {
+    throw std::runtime_error("Animation frames must have 1 to 2147483647 pixels");
+  }
+
+  const size_t pixels = static_cast<size_t>(options.width) * options.height;
+  const int window = kFramesAheadPerThread * pool.concurrency();
+  auto stop = cancelled ? cancelled : std::make_shared<std::atomic<bool>>(false);
+
+  // Finished frames waiting for the writer, and image buffers it handed back
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::map<int, std::vector<uint32_t>> finished;
+  std::vector<std::vector<uint32_t>> spareImages;
+  int written = 0;
+  bool failed = false;
+  std::exception_ptr writeError;
+  std::exception_ptr frameError;
+
+  auto stopped = [&]() { return failed || stop->load(); };
+
+  std::thread writer([&]() {
+    for (int frame = 0; frame < options.frameCount; frame++) {
+      std::vector<uint32_t> image;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]() { return finished.count(frame) > 0 || stopped(); });
+        if (finished.count(frame) == 0) {
+          return;
+        }
+        image = std::move(finished[frame]);
+        finished.erase(frame);
+      }
+
+      try {
+        write(frame, image.data());
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        writeError = std::current_exception();
+        failed = true;
+        changed.notify_all();
+        return;
+      }
+
+      std::lock_guard<std::mutex> lock(mutex);
+      spareImages.push_back(std::move(image));
+      written++;
+      changed.notify_all();
+    }
+  });
+
+  auto renderFrame = [&](int frame) {
+    std::vector<uint32_t> image;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      changed.wait(lock, [&]() { return frame < written + window || stopped(); });
+      if (stopped()) {
+        return;
+      }
+      if (!spareImages.empty()) {
+        image = std::move(spareImages.back());
+        spareImages.pop_back();
+      }
+    }
+    image.resize(pixels);
+
+    // Each frame runs on one thread, the frames in flight keep the others busy
+    AttractorParameters params = interpolateKeyframes(options.keyframes, frame);
+    std::vector<uint32_t> density(pixels, 0);
+    OccupancyMap occupancy(options.width, options.height);
+    int maxDensity = 0;
+    double x = 0;
+    double y = 0;
+    CalculationMonitor monitor;
+    monitor.cancelled = stop;
+    AccumulationContext context = {
+      .densityPtr = density.data(),
+      .densitySize = pixels,
+      .maxDensity = maxDensity,
+      .x = x,
+      .y = y,
+      .pointsToCalculate = options.pointsPerFrame,
+      .w = options.width,
+      .h = options.height,
+      .attractorParams = params,
+      .centerX = AttractorCore::centerX(params, options.width),
+      .centerY = AttractorCore::centerY(params, options.height),
+      .attractorType = AttractorCore::getAttractorType(params.attractor),
+      .monitor = &monitor,
+      .occupancy = &occupancy,
+    };
+    core.accumulateDensityParallel(context, 1, options.useSimd);
+    if (stop->load()) {
+      std::lock_guard<std::mutex> lock(mutex);
+      changed.notify_all();
+      return;
+    }
+
+    ImageDataCreationContext imageContext = {
+      .imageData = image.data(),
+      .imageSize = static_cast<int>(pixels),
+      .densityPtr = density.data(),
+      .densitySize = pixels,
+      .maxDensity = maxDensity,
+      .highQuality = options.highQuality,
+      .attractorParams = params,
+      .occupancy = &occupancy,
+    };
+    core.createImageData(imageContext);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    finished[frame] = std::move(image);
+    changed.notify_all();
+  };
+
+  // Frames are claimed in order, so the one the writer waits for is always running.
+  // A frame that throws, out of memory say, stops the others and the writer: letting it
+  // leave a pool thread or unwind past the writer would terminate.
+  pool.parallelFor(options.frameCount, [&](int frame) {
+    try {
+      renderFrame(frame);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!frameError) {
+        frameError = std::current_exception();
+      }
+      failed = true;
+      changed.notify_all();
+    }
+  });
+
+  {
+    // A cancel may come after the last frame was claimed, wake the writer either way
+    std::lock_guard<std::mutex> lock(mutex);
+    changed.notify_all();
+  }
+  writer.join();
+
+  if (frameError) {
+    std::rethrow_exception(frameError);
+  }
+  if (writeError) {
+    std::rethrow_exception(writeError);
+  }
+  return written == options.frameCount;
+}
+
+}  // namespace facebook::react
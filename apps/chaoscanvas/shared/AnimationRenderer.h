@@ -0,0 +1,55 @@
+#pragma once
+
+#include "AttractorCore.h"
+#include "WorkerPool.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace facebook::react {
+
+// Parameters the animation passes through at a frame
+struct AnimationKeyframe {
+  int frame;
+  AttractorParameters params;
+};
+
+struct AnimationOptions {
+  std::vector<AnimationKeyframe> keyframes;  // any order, at least one
+  int frameCount;
+  int width;
+  int height;
+  int pointsPerFrame;
+  bool highQuality = true;
+  bool useSimd = true;
+};
+
+// Parameters of a frame: the numbers are interpolated linearly between the keyframes
+// around it, the rest is taken from the keyframe at or before it. Frames before the
+// first keyframe or after the last one hold it.
+AttractorParameters
+interpolateKeyframes(const std::vector<AnimationKeyframe>& keyframes, int frame);
+
+// Called with each frame's 0xAABBGGRR pixels, in frame order and always on the same
+// thread. May throw, the render then stops and rethrows it.
+using AnimationFrameWriter = std::function<void(int frame, const uint32_t* pixels)>;
+
+// Renders the frames of an animation, a whole frame per thread of the pool, and hands
+// them to write() on a thread of its own. Accumulating the next frames so overlaps
+// colouring and writing the finished ones, and frames are independent, so the work
+// scales with the cores. At most a few frames per thread wait to be written.
+// Must be called from inside a job of the pool, or by the owner of a pool it submits
+// no jobs to. Returns false when cancelled became true first.
+// Throws std::runtime_error for an invalid attractor, empty keyframes or frames of more
+// than INT_MAX pixels, and rethrows what a frame or write() threw.
+bool renderAnimation(
+  AttractorCore& core,
+  WorkerPool& pool,
+  const AnimationOptions& options,
+  const AnimationFrameWriter& write,
+  const std::shared_ptr<std::atomic<bool>>& cancelled = nullptr
+);
+
+}  // namespace facebook::react
@@ -0,0 +1,957 @@
+#include "AttractorCore.h"
+#include "OrbitRecorder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+
+namespace facebook::react {
+
+namespace {
+
+// A C++ implementation of the BezierEasing function from the original JS.
+// A plain struct rather than a std::function so the palette loop inlines it.
+struct BezierEasing {
+  double p0;
+  double p1;
+  double p2;
+  double p3;
+
+  static double
+  A(double aA1, double aA2) {
+    return 1.0 - 3.0 * aA2 + 3.0 * aA1;
+  }
+
+  static double
+  B(double aA1, double aA2) {
+    return 3.0 * aA2 - 6.0 * aA1;
+  }
+
+  static double
+  C(double aA1) {
+    return 3.0 * aA1;
+  }
+
+  static double
+  calcBezier(double t, double aA1, double aA2) {
+    return ((A(aA1, aA2) * t + B(aA1, aA2)) * t + C(aA1)) * t;
+  }
+
+  static double
+  getSlope(double t, double aA1, double aA2) {
+    return 3.0 * A(aA1, aA2) * t * t + 2.0 * B(aA1, aA2) * t + C(aA1);
+  }
+
+  double
+  getTForX(double aX) const {
+    double aGuessT = aX;
+    for (int i = 0; i < 4; ++i) {
+      double currentSlope = getSlope(aGuessT, p0, p2);
+      if (currentSlope == 0.0) {
+        return aGuessT;
+      }
+      double currentX = calcBezier(aGuessT, p0, p2) - aX;
+      aGuessT -= currentX / currentSlope;
+    }
+    return aGuessT;
+  }
+
+  double
+  operator()(double x) const {
+    if (x <= 0.0) {
+      return 0.0;
+    }
+    if (x >= 1.0) {
+      return 1.0;
+    }
+    return calcBezier(getTForX(x), p1, p3);
+  }
+};
+
+constexpr BezierEasing kSaturationBezier = {0.79, -0.34, 0.54, 1.18};
+constexpr BezierEasing kDensityBezier = {0.75, 0.38, 0.24, 1.33};
+constexpr BezierEasing kOpacityBezier = {0.24, 0.27, 0.13, 0.89};
+
+RGB
+hsvToRgb(double h, double s, double v) {
+  // Exactly match JavaScript hsv2rgb implementation
+  // Clamp input values to valid ranges
+  h = std::max(0.0, std::min(359.0, h));
+  s = std::max(0.0, std::min(100.0, s));
+  v = std::max(0.0, std::min(100.0, v));
+
+  // Normalize s and v to 0-1 range
+  s /= 100.0;
+  v /= 100.0;
+
+  // Handle grayscale case (s === 0)
+  if (s == 0.0) {
+    int val = std::round(v * 255);
+    return {val, val, val};
+  }
+
+  // Convert hue to sector (0-5)
+  h /= 60.0;
+  int i = std::floor(h);
+  double f = h - i;
+
+  // Calculate color components
+  double p = v * (1.0 - s);
+  double q = v * (1.0 - s * f);
+  double t = v * (1.0 - s * (1 - f));
+
+  // Assign RGB based on hue sector
+  double r, g, b;
+  switch (i) {
+    case 0:
+      r = v;
+      g = t;
+      b = p;
+      break;
+    case 1:
+      r = q;
+      g = v;
+      b = p;
+      break;
+    case 2:
+      r = p;
+      g = v;
+      b = t;
+      break;
+    case 3:
+      r = p;
+      g = q;
+      b = v;
+      break;
+    case 4:
+      r = t;
+      g = p;
+      b = v;
+      break;
+    default:
+      r = v;
+      g = p;
+      b = q;
+      break;  // Handles case 5 and any overflow
+  }
+
+  // Return RGB values scaled to 0-255 range and rounded to integers
+  return {
+    static_cast<int>(std::round(r * 255)),
+    static_cast<int>(std::round(g * 255)),
+    static_cast<int>(std::round(b * 255))
+  };
+}
+
+// getColorData with the parts that don't depend on the density worked out once, the
+// palette calls it for every density of the frame
+class ColorMap {
+ public:
+  ColorMap(
+    double maxDensity,
+    double h,
+    double s,
+    double v,
+    double progress,
+    const std::vector<int>& background
+  )
+      : h_(h), s_(s), v_(v) {
+    // Prevent log(1) = 0 or log of negative/zero numbers
+    if (maxDensity <= 1.0) {
+      maxDensity = 1.01;
+    }
+    mdens_ = std::log(maxDensity);
+
+    // Get background color components with defaults matching JS behavior
+    // In JS: (background && background[0]) || 0
+    bgR_ = background.size() > 0 ? background[0] : 0;
+    bgG_ = background.size() > 1 ? background[1] : 0;
+    bgB_ = background.size() > 2 ? background[2] : 0;
+
+    // Match JS exactly: opacityBezier(progress || 1)
+    double effectiveProgress = progress <= 0 ? 1.0 : progress;
+    alpha_ = static_cast<uint32_t>(std::round(kOpacityBezier(effectiveProgress) * 255));
+  }
+
+  uint32_t
+  operator()(double density) const {
+    // Exactly match JavaScript behavior
+    if (density <= 0) {
+      return 0;
+    }
+    double pdens = std::log(density);
+
+    // Match JS hsv2rgb call exactly
+    double satFactor = std::max(0.0, std::min(1.0, kSaturationBezier(pdens / mdens_)));
+    RGB rgb = hsvToRgb(h_, s_ - satFactor * s_, v_);
+
+    // Match JS density_alpha calculation exactly
+    double density_alpha = std::max(0.0, std::min(1.0, kDensityBezier(pdens / mdens_)));
+
+    // Blend colors based on density_alpha exactly as JS does
+    int blendedR = std::round(rgb.r * density_alpha + bgR_ * (1 - density_alpha));
+    int blendedG = std::round(rgb.g * density_alpha + bgG_ * (1 - density_alpha));
+    int blendedB = std::round(rgb.b * density_alpha + bgB_ * (1 - density_alpha));
+
+    // Match JS bit-shifting pattern exactly
+    return (alpha_ << 24) | (static_cast<uint32_t>(blendedB) << 16) |
+      (static_cast<uint32_t>(blendedG) << 8) | static_cast<uint32_t>(blendedR);
+  }
+
+ private:
+  double h_;
+  double s_;
+  double v_;
+  double mdens_;
+  int bgR_;
+  int bgG_;
+  int bgB_;
+  uint32_t alpha_;
+};
+
+// Background as a packed RGBA pixel, transparent black when there is none
+uint32_t
+backgroundColor(const AttractorParameters& params) {
+  if (params.background.empty()) {
+    return 0;
+  }
+  uint32_t bgA = params.background.size() > 3 ? params.background[3] : 255;
+  uint32_t bgB = params.background.size() > 2 ? params.background[2] : 0;
+  uint32_t bgG = params.background.size() > 1 ? params.background[1] : 0;
+  uint32_t bgR = params.background[0];
+  return (bgA << 24) | (bgB << 16) | (bgG << 8) | bgR;
+}
+
+// Appends the extent of the marked tiles of each row of tiles, rows with the same
+// extent merged into one rectangle
+void
+appendDirtyRects(const OccupancyMap& dirty, std::vector<ImageRect>& rects) {
+  size_t firstRect = rects.size();
+  for (int tileY = 0; tileY < dirty.tileRows(); tileY++) {
+    int first = -1;
+    int last = -1;
+    for (int tileX = 0; tileX < dirty.tilesPerRow(); tileX++) {
+      if (dirty.occupied(tileX, tileY)) {
+        first = first < 0 ? tileX : first;
+        last = tileX;
+      }
+    }
+    if (last < 0) {
+      continue;
+    }
+    int x = first << kDensityTileShift;
+    int y = tileY << kDensityTileShift;
+    int width = std::min((last + 1) << kDensityTileShift, dirty.width()) - x;
+    int height = std::min(kDensityTileSize, dirty.height() - y);
+    if (rects.size() > firstRect) {
+      ImageRect& above = rects.back();
+      if (above.x == x && above.width == width && above.y + above.height == y) {
+        above.height += height;
+        continue;
+      }
+    }
+    rects.push_back({.x = x, .y = y, .width = width, .height = height});
+  }
+}
+
+}  // namespace
+
+uint32_t
+AttractorCore::getColorData(
+  double density,
+  double maxDensity,
+  double h,
+  double s,
+  double v,
+  double progress,
+  const std::vector<int>& background
+) {
+  return ColorMap(maxDensity, h, s, v, progress, background)(density);
+}
+
+uint32_t
+AttractorCore::getLowQualityPoint(double hue, double saturation, double brightness) {
+  RGB rgb = hsvToRgb(hue, saturation, brightness);
+  return (255 << 24) | (rgb.b << 16) | (rgb.g << 8) | rgb.r;
+}
+
+// Largest density the palette will tabulate, past this getColorData is called directly
+const uint32_t kMaxPaletteSize = 1 << 20;
+// Palettes with more entries than this are built on every pool thread, in blocks of it
+const uint32_t kPaletteBlock = 1 << 14;
+
+std::shared_ptr<const ColorPalette>
+AttractorCore::getColorPalette(
+  uint32_t maxDensity,
+  const AttractorParameters& params,
+  bool parallel
+) {
+  if (maxDensity == 0 || maxDensity > kMaxPaletteSize) {
+    return nullptr;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(paletteMutex_);
+    if (palette_ && palette_->matches(maxDensity, params)) {
+      return palette_;
+    }
+  }
+
+  auto palette = std::make_shared<ColorPalette>(ColorPalette{
+    .maxDensity = maxDensity,
+    .hue = params.hue,
+    .saturation = params.saturation,
+    .brightness = params.brightness,
+    .background = params.background,
+    .colors = std::vector<uint32_t>(maxDensity + 1, 0),
+  });
+  std::vector<uint32_t>& colors = palette->colors;
+  colors[0] = backgroundColor(params);
+  ColorMap colorMap(
+    maxDensity, params.hue, params.saturation, params.brightness, 1.0, params.background
+  );
+  auto fillBlock = [&](int block) {
+    uint32_t begin = 1 + static_cast<uint32_t>(block) * kPaletteBlock;
+    uint32_t end = std::min(maxDensity + 1, begin + kPaletteBlock);
+    for (uint32_t density = begin; density < end; density++) {
+      colors[density] = colorMap(density);
+    }
+  };
+  int blocks = static_cast<int>((maxDensity + kPaletteBlock - 1) / kPaletteBlock);
+  if (parallel && pool_ && blocks > 1) {
+    pool_->parallelFor(blocks, fillBlock);
+  } else {
+    for (int block = 0; block < blocks; block++) {
+      fillBlock(block);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(paletteMutex_);
+  palette_ = palette;
+  return palette;
+}
+
+// Offset smoothing() adds to each coordinate, in attractor units times the scale
+const double kSmoothingFactor = 0.2;
+
+template <typename Coin>
+inline double
+AttractorCore::smoothing(double num, double scale, Coin& coin) {
+  return num + (coin() ? -kSmoothingFactor : kSmoothingFactor) * (1.0 / scale);
+}
+
+AttractorType
+AttractorCore::getAttractorType(const std::string& attractor) {
+  if (attractor == "clifford") {
+    return AttractorType::CLIFFORD;
+  } else if (attractor == "dejong") {
+    return AttractorType::DEJONG;
+  }
+
+  // Error case - throw an exception for invalid attractor type
+  throw std::runtime_error(
+    "Invalid attractor type: " + attractor + ". Must be 'clifford' or 'dejong'."
+  );
+}
+
+// Density accumulation kernel, instantiated per attractor type, density sink and coin.
+// The map, smoothing and plotting are inlined so the loop has no indirect calls.
+template <AttractorStep step, typename Sink, typename Coin>
+void
+AttractorCore::accumulateDensityKernel(
+  AccumulationContext& context,
+  const Sink& sink,
+  Coin& coin
+) {
+  const int w = context.w;
+  const int h = context.h;
+  const int pointsToCalculate = context.pointsToCalculate;
+  const double a = context.attractorParams.a;
+  const double b = context.attractorParams.b;
+  const double c = context.attractorParams.c;
+  const double d = context.attractorParams.d;
+  const double scale = context.attractorParams.scale;
+  const double centerX = context.centerX;
+  const double centerY = context.centerY;
+  double x = context.x;
+  double y = context.y;
+  uint32_t maxDensity = context.maxDensity > 0 ? context.maxDensity : 0;
+
+  // Points are plotted in blocks, the monitor is polled in between
+  int i = 0;
+  while (i < pointsToCalculate) {
+    const int blockEnd = std::min(pointsToCalculate, i + kKernelPollInterval);
+    const int blockStart = i;
+    for (; i < blockEnd; i++) {
+      auto next = step(x, y, a, b, c, d);
+      x = smoothing(next.first, scale, coin);
+      y = smoothing(next.second, scale, coin);
+      sink.record(x, y);
+
+      int px = static_cast<int>(std::floor(centerX + x * scale));
+      int py = static_cast<int>(std::floor(centerY + y * scale));
+
+      // Unsigned compare covers both the lower and upper bound
+      if (static_cast<unsigned>(px) < static_cast<unsigned>(w) &&
+          static_cast<unsigned>(py) < static_cast<unsigned>(h)) {
+        uint32_t value = sink.plot(px, py);
+        if (value > maxDensity) {
+          maxDensity = value;
+        }
+      }
+    }
+
+    if (context.monitor &&
+        !context.monitor->poll(blockEnd - blockStart, maxDensity, context.reportsProgress)) {
+      break;
+    }
+  }
+
+  context.x = x;
+  context.y = y;
+  context.maxDensity = static_cast<int>(maxDensity);
+}
+
+// Advances an orbit without plotting, so a freshly seeded orbit settles onto the attractor
+template <AttractorStep step, typename Coin>
+void
+AttractorCore::burnInOrbit(AccumulationContext& context, int iterations, Coin& coin) {
+  const AttractorParameters& params = context.attractorParams;
+  for (int i = 0; i < iterations; i++) {
+    auto next = step(context.x, context.y, params.a, params.b, params.c, params.d);
+    context.x = smoothing(next.first, params.scale, coin);
+    context.y = smoothing(next.second, params.scale, coin);
+  }
+}
+
+template <AttractorStep step, typename Coin>
+void
+AttractorCore::plotOrbit(AccumulationContext& context, Coin& coin) {
+  withDensitySink(
+    context.densityPtr,
+    context.compact,
+    context.occupancy,
+    context.dirty,
+    context.layout,
+    context.w,
+    [&](const auto& sink) {
+      if (context.recorder) {
+        OrbitCursor cursor(*context.recorder);
+        using Sink = std::decay_t<decltype(sink)>;
+        accumulateDensityKernel<step>(context, RecordingSink<Sink>{sink, &cursor}, coin);
+      } else {
+        accumulateDensityKernel<step>(context, sink, coin);
+      }
+    }
+  );
+}
+
+template <TrigPrecision precision, typename Coin>
+void
+AttractorCore::runMapKernel(AccumulationContext& context, Coin& coin, int burnIn) {
+  switch (context.attractorType) {
+    case AttractorType::CLIFFORD:
+      burnInOrbit<clifford<precision>>(context, burnIn, coin);
+      plotOrbit<clifford<precision>>(context, coin);
+      break;
+    case AttractorType::DEJONG:
+      burnInOrbit<dejong<precision>>(context, burnIn, coin);
+      plotOrbit<dejong<precision>>(context, coin);
+      break;
+  }
+}
+
+template <typename Coin>
+void
+AttractorCore::runKernel(AccumulationContext& context, Coin& coin, int burnIn) {
+  // Pick the kernel once per call instead of dispatching per point
+  switch (context.attractorParams.precision) {
+    case TrigPrecision::EXACT:
+      runMapKernel<TrigPrecision::EXACT>(context, coin, burnIn);
+      break;
+    case TrigPrecision::FLOAT:
+      runMapKernel<TrigPrecision::FLOAT>(context, coin, burnIn);
+      break;
+    case TrigPrecision::FAST:
+      runMapKernel<TrigPrecision::FAST>(context, coin, burnIn);
+      break;
+  }
+}
+
+void
+AttractorCore::accumulateDensity(AccumulationContext& context, uint64_t seed) {
+  CounterCoin coin(coinStreamKey(seed, 0, context.x, context.y));
+  runKernel(context, coin, 0);
+}
+
+void
+AttractorCore::accumulateDensity(AccumulationContext& context, CounterCoin& coin) {
+  runKernel(context, coin, 0);
+}
+
+// Below this many points per orbit, thread start-up costs more than it saves
+const int kMinPointsPerOrbit = 250000;
+// Iterations an extra orbit runs before it starts plotting
+const int kOrbitBurnIn = 100;
+// Memory the private density shards of the extra orbits may use together
+const size_t kMaxShardBytes = 256 * 1024 * 1024;
+// Orbits a seeded render is split into, whatever the thread count
+const int kSeededOrbits = 8;
+
+int
+AttractorCore::resolveOrbitCount(int maxOrbits, int pointsToCalculate, size_t densitySize) {
+  int orbitCount = std::max(1, maxOrbits);
+  orbitCount = std::min(orbitCount, std::max(1, pointsToCalculate / kMinPointsPerOrbit));
+
+  // Every orbit but the first writes into its own shard of the density buffer
+  size_t shardBytes = std::max<size_t>(1, densitySize * sizeof(uint32_t));
+  size_t maxShards = kMaxShardBytes / shardBytes;
+  return static_cast<int>(std::min<size_t>(orbitCount, maxShards + 1));
+}
+
+size_t
+AttractorCore::maxSeededDensitySize() {
+  return kMaxShardBytes / sizeof(uint32_t) / (kSeededOrbits - 1);
+}
+
+int
+AttractorCore::resolveThreadCount(int requested, int pointsToCalculate, size_t densitySize) {
+  int threadCount = requested > 0 ? requested : (pool_ ? pool_->concurrency() : 1);
+  return resolveOrbitCount(threadCount, pointsToCalculate, densitySize);
+}
+
+// KernelPoll adapter, lets the SIMD kernel poll the job's monitor
+static bool
+pollMonitor(void* user, int points, uint32_t maxDensity) {
+  auto* context = static_cast<AccumulationContext*>(user);
+  return context->monitor->poll(points, maxDensity, context->reportsProgress);
+}
+
+// Runs one thread's share of the points. With SIMD the share is split over the
+// kernel's lanes, all starting from the context's point and burned in together.
+void
+AttractorCore::runOrbitGroup(
+  AccumulationContext& context,
+  SimdLevel simdLevel,
+  CounterCoin& coin,
+  bool continuesOrbit
+) {
+  int burnIn = continuesOrbit ? 0 : kOrbitBurnIn;
+  if (simdLevel == SimdLevel::SCALAR) {
+    runKernel(context, coin, burnIn);
+    return;
+  }
+
+  int lanes = simdLaneCount(simdLevel);
+  std::vector<double> laneX(lanes, context.x);
+  std::vector<double> laneY(lanes, context.y);
+  std::vector<uint64_t> laneRng(lanes);
+  for (auto& state : laneRng) {
+    // xorshift must not start at 0, the low bit keeps it odd
+    state = coin.next64() | 1;
+  }
+
+  SimdOrbitContext simdContext = {
+    .densityPtr = context.densityPtr,
+    .compact = context.compact,
+    .occupancy = context.occupancy,
+    .dirty = context.dirty,
+    .recorder = context.recorder,
+    .w = context.w,
+    .h = context.h,
+    .layout = context.layout,
+    .a = context.attractorParams.a,
+    .b = context.attractorParams.b,
+    .c = context.attractorParams.c,
+    .d = context.attractorParams.d,
+    .scale = context.attractorParams.scale,
+    .smoothingFactor = kSmoothingFactor,
+    .centerX = context.centerX,
+    .centerY = context.centerY,
+    .dejong = context.attractorType == AttractorType::DEJONG,
+    .precision = context.attractorParams.precision,
+    .x = laneX.data(),
+    .y = laneY.data(),
+    .rngState = laneRng.data(),
+    .iterations = context.pointsToCalculate / lanes,
+    .burnIn = kOrbitBurnIn,
+    .maxDensity = static_cast<uint32_t>(std::max(0, context.maxDensity)),
+    .poll = context.monitor ? KernelPoll{pollMonitor, &context} : KernelPoll{},
+    .stopped = false,
+  };
+  accumulateDensitySimd(simdLevel, simdContext);
+
+  // The points that don't divide evenly over the lanes continue lane 0 in scalar code
+  context.x = laneX[0];
+  context.y = laneY[0];
+  context.maxDensity = static_cast<int>(simdContext.maxDensity);
+  if (simdContext.stopped) {
+    return;
+  }
+  AccumulationContext remainder = {
+    .densityPtr = context.densityPtr,
+    .densitySize = context.densitySize,
+    .maxDensity = context.maxDensity,
+    .x = context.x,
+    .y = context.y,
+    .pointsToCalculate = context.pointsToCalculate % lanes,
+    .w = context.w,
+    .h = context.h,
+    .attractorParams = context.attractorParams,
+    .centerX = context.centerX,
+    .centerY = context.centerY,
+    .attractorType = context.attractorType,
+    .monitor = context.monitor,
+    .reportsProgress = context.reportsProgress,
+    .layout = context.layout,
+    .compact = context.compact,
+    .occupancy = context.occupancy,
+    .dirty = context.dirty,
+    .recorder = context.recorder,
+  };
+  runKernel(remainder, coin, 0);
+}
+
+void
+AttractorCore::accumulateDensityParallel(
+  AccumulationContext& context,
+  int threadCount,
+  bool useSimd
+) {
+  threadCount = std::max(1, threadCount);
+
+  // A seeded render is split the same way on any device and always runs the scalar
+  // kernel, so only the seed decides the coins each orbit sees
+  const std::optional<uint64_t>& requestedSeed = context.attractorParams.seed;
+  bool seeded = requestedSeed.has_value();
+  SimdLevel simdLevel = useSimd && !seeded ? detectSimdLevel() : SimdLevel::SCALAR;
+  int orbitCount = seeded
+    ? resolveOrbitCount(kSeededOrbits, context.pointsToCalculate, context.densitySize)
+    : threadCount;
+
+  uint64_t seed;
+  if (seeded) {
+    seed = *requestedSeed;
+  } else {
+    std::random_device seeder;
+    seed = (static_cast<uint64_t>(seeder()) << 32) | seeder();
+  }
+
+  if (orbitCount == 1 && simdLevel == SimdLevel::SCALAR) {
+    accumulateDensity(context, seed);
+    return;
+  }
+
+  // Orbits run on the pool, or one after the other without one or for a single thread
+  auto forEachOrbit = [&](const std::function<void(int)>& fn) {
+    if (threadCount > 1 && pool_) {
+      pool_->parallelFor(orbitCount, fn);
+    } else {
+      for (int orbit = 0; orbit < orbitCount; orbit++) {
+        fn(orbit);
+      }
+    }
+  };
+
+  // Orbit group 0 continues the caller's orbit straight into the output buffer.
+  // The other groups start from the same point, burn in, and fill private shards,
+  // compact ones when the output is compact.
+  std::vector<std::vector<uint32_t>> shards(orbitCount - 1);
+  std::vector<std::unique_ptr<CompactDensity>> compactShards(orbitCount - 1);
+  std::vector<double> orbitX(orbitCount, context.x);
+  std::vector<double> orbitY(orbitCount, context.y);
+  std::vector<int> orbitMaxDensity(orbitCount, 0);
+  int pointsPerOrbit = context.pointsToCalculate / orbitCount;
+
+  forEachOrbit([&](int orbit) {
+    uint32_t* densityPtr = context.densityPtr;
+    CompactDensity* compact = context.compact;
+    int points = pointsPerOrbit;
+    if (orbit == 0) {
+      orbitMaxDensity[0] = context.maxDensity;
+      points = context.pointsToCalculate - pointsPerOrbit * (orbitCount - 1);
+    } else if (compact) {
+      compactShards[orbit - 1] = std::make_unique<CompactDensity>(context.densitySize);
+      compact = compactShards[orbit - 1].get();
+    } else {
+      shards[orbit - 1].assign(context.densitySize, 0);
+      densityPtr = shards[orbit - 1].data();
+    }
+
+    AccumulationContext orbitContext = {
+      .densityPtr = densityPtr,
+      .densitySize = context.densitySize,
+      .maxDensity = orbitMaxDensity[orbit],
+      .x = orbitX[orbit],
+      .y = orbitY[orbit],
+      .pointsToCalculate = points,
+      .w = context.w,
+      .h = context.h,
+      .attractorParams = context.attractorParams,
+      .centerX = context.centerX,
+      .centerY = context.centerY,
+      .attractorType = context.attractorType,
+      .monitor = context.monitor,
+      .reportsProgress = orbit == 0 && context.reportsProgress,
+      .layout = context.layout,
+      .compact = compact,
+      .occupancy = context.occupancy,
+      .dirty = context.dirty,
+      .recorder = context.recorder,
+    };
+    CounterCoin coin(coinStreamKey(seed, orbit, context.x, context.y));
+    runOrbitGroup(orbitContext, simdLevel, coin, orbit == 0);
+  });
+
+  // A cancelled job is thrown away, don't spend time merging it
+  if (context.monitor && context.monitor->cancelled->load()) {
+    return;
+  }
+
+  if (orbitCount == 1) {
+    context.maxDensity = orbitMaxDensity[0];
+    context.x = orbitX[0];
+    context.y = orbitY[0];
+    return;
+  }
+
+  // Merge the shards into the output buffer in row bands, tracking the max of the sums
+  std::vector<uint32_t> bandMaxDensity(orbitCount, 0);
+  size_t bandSize = (context.densitySize + orbitCount - 1) / orbitCount;
+  if (context.compact) {
+    // Whole blocks per band, so two bands never promote the same block
+    bandSize = (bandSize + CompactDensity::kBlockMask) & ~CompactDensity::kBlockMask;
+  }
+  forEachOrbit([&](int band) {
+    size_t start = std::min(context.densitySize, band * bandSize);
+    size_t end = std::min(context.densitySize, start + bandSize);
+    uint32_t maxDensity = 0;
+    if (context.compact) {
+      for (size_t i = start; i < end; i++) {
+        uint32_t sum = context.compact->get(i);
+        for (const auto& shard : compactShards) {
+          sum += shard->get(i);
+        }
+        context.compact->set(i, sum);
+        maxDensity = std::max(maxDensity, sum);
+      }
+      bandMaxDensity[band] = maxDensity;
+      return;
+    }
+    for (size_t i = start; i < end; i++) {
+      uint32_t sum = context.densityPtr[i];
+      for (const auto& shard : shards) {
+        sum += shard[i];
+      }
+      context.densityPtr[i] = sum;
+      maxDensity = std::max(maxDensity, sum);
+    }
+    bandMaxDensity[band] = maxDensity;
+  });
+
+  uint32_t maxDensity = *std::max_element(bandMaxDensity.begin(), bandMaxDensity.end());
+  context.maxDensity = std::max(context.maxDensity, static_cast<int>(maxDensity));
+  context.x = orbitX[0];
+  context.y = orbitY[0];
+}
+
+// Pixels of the row-major image each colouring work item covers
+const size_t kColorizeChunk = 1 << 14;
+
+void
+AttractorCore::createImageData(ImageDataCreationContext& context) {
+  const AttractorParameters& params = context.attractorParams;
+  uint32_t bgColor = backgroundColor(params);
+
+  // Colours are fixed for the frame, so look them up instead of recomputing per pixel
+  std::shared_ptr<const ColorPalette> palette;
+  if (context.highQuality && context.maxDensity > 0) {
+    palette = getColorPalette(static_cast<uint32_t>(context.maxDensity), params, context.parallel);
+  }
+  uint32_t lowQualityColor = getLowQualityPoint(params.hue, params.saturation, params.brightness);
+  SimdLevel simdLevel = detectSimdLevel();
+
+  auto colorOf = [&](uint32_t dval) {
+    if (dval == 0) {
+      return bgColor;
+    }
+    if (!context.highQuality) {
+      return lowQualityColor;
+    }
+    if (palette && dval <= palette->maxDensity) {
+      return palette->colors[dval];
+    }
+    return getColorData(
+      dval,
+      context.maxDensity,
+      params.hue,
+      params.saturation,
+      params.brightness,
+      1.0,
+      params.background
+    );
+  };
+
+  // Colours count pixels with the vector kernels, or one by one when a density is past
+  // the palette
+  auto colorSpan = [&](const uint32_t* density, uint32_t* image, size_t count) {
+    if (!context.highQuality) {
+      colorizeFlat(simdLevel, density, image, count, lowQualityColor, bgColor);
+      return;
+    }
+    if (palette &&
+        colorizeDensity(
+          simdLevel, density, image, count, palette->colors.data(), palette->maxDensity
+        )) {
+      return;
+    }
+    for (size_t i = 0; i < count; i++) {
+      image[i] = colorOf(density[i]);
+    }
+  };
+
+  // Density from begin on, decoded into scratch for compact counters
+  auto densitySpan = [&](size_t begin, size_t count, std::vector<uint32_t>& scratch) {
+    if (!context.compact) {
+      return context.densityPtr + begin;
+    }
+    scratch.resize(count);
+    for (size_t i = 0; i < count; i++) {
+      scratch[i] = context.compact->get(begin + i);
+    }
+    return static_cast<const uint32_t*>(scratch.data());
+  };
+
+  // The work items only write their own pixels, they run on every pool thread when allowed
+  auto forEachItem = [&](int count, const std::function<void(int)>& fn) {
+    if (context.parallel && pool_ && count > 1) {
+      pool_->parallelFor(count, fn);
+    } else {
+      for (int item = 0; item < count; item++) {
+        fn(item);
+      }
+    }
+  };
+
+  const OccupancyMap* occupancy = context.occupancy;
+  // Low quality colours don't depend on the max density, high quality ones need the one
+  // the clean tiles were coloured with
+  const OccupancyMap* dirty = context.dirty;
+  bool coarse = context.pyramid && context.pyramidLevel > 0;
+  bool incremental = !coarse && dirty && context.coloredMaxDensity >= 0 &&
+    (!context.highQuality || context.coloredMaxDensity == context.maxDensity);
+
+  if (context.changedRects) {
+    if (incremental) {
+      appendDirtyRects(*dirty, *context.changedRects);
+    } else {
+      const OccupancyMap* map = occupancy ? occupancy : dirty;
+      int width = !context.width && map ? map->width() : context.width;
+      int height = !context.width && map ? map->height() : context.height;
+      if (width > 0 && height > 0) {
+        context.changedRects->push_back({.x = 0, .y = 0, .width = width, .height = height});
+      }
+    }
+  }
+
+  if (coarse) {
+    // A few rows of the level per work item, each coloured once and repeated over the
+    // block of image rows it covers
+    int level = context.pyramidLevel;
+    int levelWidth = DensityPyramid::levelSize(context.width, level);
+    int levelHeight = DensityPyramid::levelSize(context.height, level);
+    const uint32_t* levelDensity = context.pyramid->level(level);
+    const int rowsPerItem = std::max(1, kDensityTileSize >> level);
+    forEachItem((levelHeight + rowsPerItem - 1) / rowsPerItem, [&](int item) {
+      std::vector<uint32_t> colors(levelWidth);
+      int endRow = std::min(levelHeight, (item + 1) * rowsPerItem);
+      for (int row = item * rowsPerItem; row < endRow; row++) {
+        colorSpan(levelDensity + static_cast<size_t>(row) * levelWidth, colors.data(), levelWidth);
+        int y0 = row << level;
+        uint32_t* first = context.imageData + static_cast<size_t>(y0) * context.width;
+        for (int x = 0; x < context.width; x++) {
+          first[x] = colors[x >> level];
+        }
+        int rows = std::min(1 << level, context.height - y0);
+        for (int y = 1; y < rows; y++) {
+          std::copy_n(first, context.width, first + static_cast<size_t>(y) * context.width);
+        }
+      }
+    });
+    return;
+  }
+
+  if (context.layout == DensityLayout::TILED) {
+    // One row of tiles per work item, each tile read in order and its rows written into
+    // the row-major image
+    int tilesPerRow = densityTileCount(context.width);
+    forEachItem(densityTileCount(context.height), [&](int tileY) {
+      std::vector<uint32_t> scratch;
+      for (int tileX = 0; tileX < tilesPerRow; tileX++) {
+        int x0 = tileX << kDensityTileShift;
+        int y0 = tileY << kDensityTileShift;
+        int columns = std::min(kDensityTileSize, context.width - x0);
+        int rows = std::min(kDensityTileSize, context.height - y0);
+        if (incremental && !dirty->occupied(tileX, tileY)) {
+          continue;
+        }
+        if (occupancy && !occupancy->occupied(tileX, tileY)) {
+          for (int row = 0; row < rows; row++) {
+            size_t begin = static_cast<size_t>(y0 + row) * context.width + x0;
+            std::fill_n(context.imageData + begin, columns, bgColor);
+          }
+          continue;
+        }
+        size_t tile = (static_cast<size_t>(tileY) * tilesPerRow + tileX) * kDensityTileArea;
+        const uint32_t* density = densitySpan(tile, kDensityTileArea, scratch);
+        for (int row = 0; row < rows; row++) {
+          uint32_t* dst = context.imageData + static_cast<size_t>(y0 + row) * context.width + x0;
+          colorSpan(density + (row << kDensityTileShift), dst, columns);
+        }
+      }
+    });
+    return;
+  }
+
+  if (const OccupancyMap* runs = incremental ? dirty : occupancy) {
+    // One row of tiles per work item, its image rows coloured in runs of marked tiles.
+    // Runs of clear ones are filled with the background, or left alone when they are
+    // clean.
+    int width = runs->width();
+    int height = runs->height();
+    forEachItem(runs->tileRows(), [&](int tileY) {
+      std::vector<uint32_t> scratch;
+      int y0 = tileY << kDensityTileShift;
+      int rows = std::min(kDensityTileSize, height - y0);
+      runs->forEachRun(tileY, [&](int tileX, int endTileX, bool marked) {
+        if (!marked && incremental) {
+          return;
+        }
+        int x0 = tileX << kDensityTileShift;
+        int columns = std::min(endTileX << kDensityTileShift, width) - x0;
+        for (int row = 0; row < rows; row++) {
+          size_t begin = static_cast<size_t>(y0 + row) * width + x0;
+          if (marked) {
+            colorSpan(densitySpan(begin, columns, scratch), context.imageData + begin, columns);
+          } else {
+            std::fill_n(context.imageData + begin, columns, bgColor);
+          }
+        }
+      });
+    });
+    return;
+  }
+
+  size_t pixels = static_cast<size_t>(std::max(0, context.imageSize));
+  int chunks = static_cast<int>((pixels + kColorizeChunk - 1) / kColorizeChunk);
+  forEachItem(chunks, [&](int chunk) {
+    std::vector<uint32_t> scratch;
+    size_t begin = static_cast<size_t>(chunk) * kColorizeChunk;
+    size_t count = std::min(kColorizeChunk, pixels - begin);
+    colorSpan(densitySpan(begin, count, scratch), context.imageData + begin, count);
+  });
+}
+
+}  // namespace facebook::react
@@ -0,0 +1,281 @@
+#pragma once
+
+#include "AttractorRandom.h"
+#include "DensityLayout.h"
+#include "AttractorSimd.h"
+#include "CompactDensity.h"
+#include "DensityPyramid.h"
+#include "FastTrig.h"
+#include "OccupancyMap.h"
+#include "WorkerPool.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace facebook::react {
+
+class OrbitRecorder;
+
+enum class AttractorType { CLIFFORD, DEJONG };
+
+// Attractor map used as a template argument, so the kernel can inline it
+using AttractorStep = std::pair<double, double> (*)(double, double, double, double, double, double);
+
+// Represents an RGB color
+struct RGB {
+  int r, g, b;
+};
+
+struct AttractorParameters {
+  std::string attractor;
+  double a;
+  double b;
+  double c;
+  double d;
+  double hue;
+  double saturation;
+  double brightness;
+  std::vector<int> background;
+  double scale;
+  double left;
+  double top;
+  // Seeds the smoothing coins. With a seed the density buffer only depends on the
+  // parameters, the seed and the start point, not on the thread count.
+  std::optional<uint64_t> seed;
+  // Accuracy of sin and cos in the map, see FastTrig.h
+  TrigPrecision precision = TrigPrecision::EXACT;
+};
+
+// Colour lookup table keyed by integer density.
+// Colour only depends on density once hue, saturation, brightness, background and
+// maxDensity are fixed, so it is built once per frame and reused until one of them changes.
+struct ColorPalette {
+  uint32_t maxDensity;
+  double hue;
+  double saturation;
+  double brightness;
+  std::vector<int> background;
+  std::vector<uint32_t> colors;  // colors[density], index 0 is the background
+
+  bool
+  matches(uint32_t newMaxDensity, const AttractorParameters& params) const {
+    return maxDensity == newMaxDensity && hue == params.hue && saturation == params.saturation &&
+      brightness == params.brightness && background == params.background;
+  }
+};
+
+// Cancellation and progress of one calculation job, shared by all of its orbits
+struct CalculationMonitor {
+  std::shared_ptr<std::atomic<bool>> cancelled;
+  std::atomic<int64_t> pointsDone{0};
+  // Runs on orbit 0's thread when a report is due, with its running max density (nullable)
+  std::function<void(int64_t pointsDone, uint32_t maxDensity)> report;
+  std::chrono::steady_clock::duration reportInterval{};
+  std::chrono::steady_clock::time_point nextReport{};
+
+  // Called by the kernels between blocks of points, returns false once the job is cancelled
+  bool
+  poll(int points, uint32_t maxDensity, bool reportsProgress) {
+    pointsDone.fetch_add(points, std::memory_order_relaxed);
+    if (cancelled->load(std::memory_order_relaxed)) {
+      return false;
+    }
+    if (reportsProgress && report) {
+      auto now = std::chrono::steady_clock::now();
+      if (now >= nextReport) {
+        nextReport = now + reportInterval;
+        report(pointsDone.load(std::memory_order_relaxed), maxDensity);
+      }
+    }
+    return true;
+  }
+};
+
+struct AccumulationContext {
+  uint32_t* densityPtr;
+  size_t densitySize;
+  int& maxDensity;
+  double& x;
+  double& y;
+  const int pointsToCalculate;
+  const int w;
+  const int h;
+  const AttractorParameters& attractorParams;
+  const double centerX;
+  const double centerY;
+  const AttractorType attractorType;
+  CalculationMonitor* monitor = nullptr;  // nullable
+  bool reportsProgress = false;           // only orbit 0 reports, it owns the output buffer
+  // densitySize must be densityBufferSize(layout, w, h)
+  DensityLayout layout = DensityLayout::ROW_MAJOR;
+  CompactDensity* compact = nullptr;  // replaces densityPtr when set
+  OccupancyMap* occupancy = nullptr;  // marked as points land when set
+  OccupancyMap* dirty = nullptr;      // marked on every point when set
+  OrbitRecorder* recorder = nullptr;  // keeps every plotted point when set
+};
+
+// Pixels of the image, the rectangles a colouring reports it wrote
+struct ImageRect {
+  int x;
+  int y;
+  int width;
+  int height;
+};
+
+struct ImageDataCreationContext {
+  uint32_t* imageData;
+  int imageSize;
+  const uint32_t* densityPtr;
+  size_t densitySize;
+  int maxDensity;
+  bool highQuality;
+  const AttractorParameters& attractorParams;
+  // A tiled density buffer is coloured tile by tile into the row-major image,
+  // which needs the image size
+  DensityLayout layout = DensityLayout::ROW_MAJOR;
+  int width = 0;
+  int height = 0;
+  const CompactDensity* compact = nullptr;  // replaces densityPtr when set
+  // Tiles of the density with a point, the clear ones are filled with the background.
+  // A row-major image takes its size from the map.
+  const OccupancyMap* occupancy = nullptr;
+  // Tiles with points added since the image was last coloured, marked through
+  // AccumulationContext::dirty. coloredMaxDensity is the max density of that colouring,
+  // -1 when the image holds none. With the same parameters and quality the caller
+  // promises, and the same max density for high quality, only the dirty tiles are
+  // coloured and the rest of the image is left as it is.
+  const OccupancyMap* dirty = nullptr;
+  int coloredMaxDensity = -1;
+  // Gets the rectangles the colouring wrote appended: the whole image, or the extent of
+  // the dirty tiles row by row. Needs width and height, or one of the maps.
+  std::vector<ImageRect>* changedRects = nullptr;
+  // Colours level pyramidLevel of the pyramid instead of the density, for a preview
+  // early in a render, each of its pixels scaled up to a block of the image. maxDensity
+  // is then the level's, and width and height are needed.
+  const DensityPyramid* pyramid = nullptr;
+  int pyramidLevel = 0;
+  // Colours on every pool thread. Only set where the caller may run parallelFor, a
+  // frame coloured from inside a parallelFor item has to leave it off.
+  bool parallel = false;
+};
+
+// Iteration and colouring shared by the React Native module, the WASM module and the
+// native tools. Knows nothing about JSI or embind, parallel work runs on the WorkerPool
+// it is given.
+class AttractorCore {
+ public:
+  // Without a pool everything runs on the calling thread, as in the WASM module
+  AttractorCore() = default;
+  explicit AttractorCore(WorkerPool& pool) : pool_(&pool) {}
+
+  AttractorCore(const AttractorCore&) = delete;
+  AttractorCore& operator=(const AttractorCore&) = delete;
+
+  // Throws std::runtime_error for anything but "clifford" and "dejong"
+  static AttractorType getAttractorType(const std::string& attractor);
+
+  void accumulateDensity(AccumulationContext& context, uint64_t seed);
+  // Continues the coins of an earlier call, so a render split over many calls sees the
+  // same coins as a single call
+  void accumulateDensity(AccumulationContext& context, CounterCoin& coin);
+  // Splits the points over independent orbits with private density shards, then merges them
+  void accumulateDensityParallel(AccumulationContext& context, int threadCount, bool useSimd);
+  // Orbits worth running for a job, requested 0 means every thread of the pool
+  int resolveThreadCount(int requested, int pointsToCalculate, size_t densitySize);
+  // Largest density buffer a seeded render still splits into the same orbits as a
+  // smaller one, so renders of different regions replay the same points
+  static size_t maxSeededDensitySize();
+  void createImageData(ImageDataCreationContext& context);
+
+  // Screen position of the attractor's origin on a width x height canvas: the middle,
+  // moved by left and top in canvas widths and heights
+  static double centerX(const AttractorParameters& params, int width);
+  static double centerY(const AttractorParameters& params, int height);
+
+  uint32_t getColorData(
+    double density,
+    double maxDensity,
+    double h,
+    double s,
+    double v,
+    double progress = 1.0,
+    const std::vector<int>& background = {0, 0, 0, 255}
+  );
+  uint32_t getLowQualityPoint(double hue, double saturation, double brightness);
+
+  // One step of each map, without smoothing
+  template <TrigPrecision precision = TrigPrecision::EXACT>
+  static std::pair<double, double>
+  clifford(double x, double y, double a, double b, double c, double d);
+  template <TrigPrecision precision = TrigPrecision::EXACT>
+  static std::pair<double, double>
+  dejong(double x, double y, double a, double b, double c, double d);
+
+ private:
+  std::shared_ptr<const ColorPalette>
+  getColorPalette(uint32_t maxDensity, const AttractorParameters& attractorParams, bool parallel);
+  template <typename Coin>
+  static double smoothing(double num, double scale, Coin& coin);
+  template <AttractorStep step, typename Sink, typename Coin>
+  void accumulateDensityKernel(AccumulationContext& context, const Sink& sink, Coin& coin);
+  template <AttractorStep step, typename Coin>
+  void plotOrbit(AccumulationContext& context, Coin& coin);
+  template <AttractorStep step, typename Coin>
+  void burnInOrbit(AccumulationContext& context, int iterations, Coin& coin);
+  template <TrigPrecision precision, typename Coin>
+  void runMapKernel(AccumulationContext& context, Coin& coin, int burnIn);
+  template <typename Coin>
+  void runKernel(AccumulationContext& context, Coin& coin, int burnIn);
+  void runOrbitGroup(
+    AccumulationContext& context,
+    SimdLevel simdLevel,
+    CounterCoin& coin,
+    bool continuesOrbit
+  );
+  static int resolveOrbitCount(int maxOrbits, int pointsToCalculate, size_t densitySize);
+
+  WorkerPool* pool_ = nullptr;
+
+  // Last colour palette, shared by calculation jobs of the same render
+  std::shared_ptr<const ColorPalette> palette_;
+  std::mutex paletteMutex_;
+};
+
+inline double
+AttractorCore::centerX(const AttractorParameters& params, int width) {
+  return width / 2.0 + params.left * width;
+}
+
+inline double
+AttractorCore::centerY(const AttractorParameters& params, int height) {
+  return height / 2.0 + params.top * height;
+}
+
+// Defined here so the kernels and the benchmarks both inline them
+template <TrigPrecision precision>
+inline std::pair<double, double>
+AttractorCore::clifford(double x, double y, double a, double b, double c, double d) {
+  return {
+    trigSin<precision>(a * y) + c * trigCos<precision>(a * x),
+    trigSin<precision>(b * x) + d * trigCos<precision>(b * y)
+  };
+}
+
+template <TrigPrecision precision>
+inline std::pair<double, double>
+AttractorCore::dejong(double x, double y, double a, double b, double c, double d) {
+  return {
+    trigSin<precision>(a * y) - trigCos<precision>(b * x),
+    trigSin<precision>(c * x) - trigCos<precision>(d * y)
+  };
+}
+
+}  // namespace facebook::react
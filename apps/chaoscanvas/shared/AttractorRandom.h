@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace facebook::react {
+
+// SplitMix64 finalizer, a cheap bijective 64-bit hash
+inline uint64_t
+mixBits(uint64_t value) {
+  value ^= value >> 30;
+  value *= 0xbf58476d1ce4e5b9ull;
+  value ^= value >> 27;
+  value *= 0x94d049bb133111ebull;
+  value ^= value >> 31;
+  return value;
+}
+
+inline uint64_t
+doubleBits(double value) {
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+// Key of an independent coin stream. The stream depends on the render seed, the
+// orbit index and the point the orbit starts from, so a stream is reproducible
+// without any state shared between orbits or threads.
+inline uint64_t
+coinStreamKey(uint64_t seed, uint64_t orbit, double x, double y) {
+  uint64_t key = mixBits(seed + 0x9e3779b97f4a7c15ull);
+  key = mixBits(key ^ (orbit + 1) * 0xd1b54a32d192ed03ull);
+  key = mixBits(key ^ doubleBits(x));
+  return mixBits(key ^ doubleBits(y));
+}
+
+// Counter-based coin flip for smoothing(). Block n of a stream is mixBits(key + n * gamma),
+// and each block hands out its 64 bits one coin at a time.
+struct CounterCoin {
+  uint64_t key;
+  uint64_t counter = 0;
+  uint64_t bits = 0;
+  int remaining = 0;
+
+  explicit CounterCoin(uint64_t streamKey) : key(streamKey) {}
+
+  uint64_t
+  next64() {
+    return mixBits(key + (++counter) * 0x9e3779b97f4a7c15ull);
+  }
+
+  bool
+  operator()() {
+    if (remaining == 0) {
+      bits = next64();
+      remaining = 64;
+    }
+    bool coin = bits & 1;
+    bits >>= 1;
+    remaining--;
+    return coin;
+  }
+};
+
+}  // namespace facebook::react
@@ -0,0 +1,484 @@
+#include "AttractorSimd.h"
+#include "CompactDensity.h"
+#include "OrbitRecorder.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace facebook::react {
+
+namespace {
+
+// Everything below is inlined into the per-ISA entry points, so each one gets its own
+// codegen from the same source. Vectors are passed by reference to keep the ABI out of it.
+#define SIMD_INLINE inline __attribute__((always_inline))
+
+// GCC/Clang vector extensions, lowered to AVX2, SSE2 or NEON depending on the caller's target
+template <int Lanes>
+struct Vec;
+
+template <>
+struct Vec<4> {
+  typedef double D __attribute__((vector_size(32)));
+  typedef int64_t I __attribute__((vector_size(32)));
+  typedef uint64_t U __attribute__((vector_size(32)));
+  typedef uint32_t U32 __attribute__((vector_size(16)));
+};
+
+template <>
+struct Vec<8> {
+  typedef double D __attribute__((vector_size(64)));
+  typedef int64_t I __attribute__((vector_size(64)));
+  typedef uint64_t U __attribute__((vector_size(64)));
+  typedef uint32_t U32 __attribute__((vector_size(32)));
+};
+
+// fdlibm __kernel_sin / __kernel_cos coefficients on [-pi/4, pi/4], max error below 1 ulp
+constexpr double kS1 = -1.66666666666666324348e-01;
+constexpr double kS2 = 8.33333333332248946124e-03;
+constexpr double kS3 = -1.98412698298579493134e-04;
+constexpr double kS4 = 2.75573137070700676789e-06;
+constexpr double kS5 = -2.50507602534068634195e-08;
+constexpr double kS6 = 1.58969099521155010221e-10;
+constexpr double kC1 = 4.16666666666666019037e-02;
+constexpr double kC2 = -1.38888888888741095749e-03;
+constexpr double kC3 = 2.48015872894767294178e-05;
+constexpr double kC4 = -2.75573143513906633035e-07;
+constexpr double kC5 = 2.08757232129817482790e-09;
+constexpr double kC6 = -1.13596475577881948265e-11;
+
+// sin(x), or cos(x) as sin(x + pi/2), for every lane. The range reduction (FastTrig.h)
+// is the same for every precision, the cheaper ones have shorter polynomials.
+template <int Lanes, bool Cosine, TrigPrecision Precision>
+SIMD_INLINE void
+vectorSin(const typename Vec<Lanes>::D& x, typename Vec<Lanes>::D& out) {
+  using D = typename Vec<Lanes>::D;
+  using I = typename Vec<Lanes>::I;
+
+  D quadrantD = (x * kTwoOverPi + kRoundMagic) - kRoundMagic;
+  I quadrant = __builtin_convertvector(quadrantD, I);
+  if (Cosine) {
+    quadrant += 1;
+  }
+
+  D r = (x - quadrantD * kPio2Hi) - quadrantD * kPio2Lo;
+  D z = r * r;
+  D s, c;
+  if (Precision == TrigPrecision::FAST) {
+    s = r + r * z * (kFastS1 + z * kFastS2);
+    c = 1.0 + z * (kFastC1 + z * kFastC2);
+  } else if (Precision == TrigPrecision::FLOAT) {
+    s = r + r * z * (kFloatS1 + z * (kFloatS2 + z * kFloatS3));
+    c = 1.0 + z * (kFloatC1 + z * (kFloatC2 + z * kFloatC3));
+  } else {
+    s = r + r * z * (kS1 + z * (kS2 + z * (kS3 + z * (kS4 + z * (kS5 + z * kS6)))));
+    c = 1.0 - 0.5 * z + z * z * (kC1 + z * (kC2 + z * (kC3 + z * (kC4 + z * (kC5 + z * kC6)))));
+  }
+
+  // Odd quadrants use the cosine polynomial, quadrants 2 and 3 flip the sign
+  I useCos = (quadrant & 1) != 0;
+  I bits = ((I)c & useCos) | ((I)s & ~useCos);
+  bits ^= (quadrant & 2) << 62;
+  out = (D)bits;
+}
+
+struct OrbitParams {
+  double a;
+  double b;
+  double c;
+  double d;
+  double step;  // smoothing offset, factor / scale
+};
+
+// One attractor step plus smoothing for every lane
+template <int Lanes, bool Dejong, TrigPrecision Precision>
+SIMD_INLINE void
+advanceOrbits(
+  typename Vec<Lanes>::D& x,
+  typename Vec<Lanes>::D& y,
+  typename Vec<Lanes>::U& rng,
+  const OrbitParams& params
+) {
+  using D = typename Vec<Lanes>::D;
+  using I = typename Vec<Lanes>::I;
+
+  D sin1, cos1, sin2, cos2;
+  if (Dejong) {
+    vectorSin<Lanes, false, Precision>(params.a * y, sin1);
+    vectorSin<Lanes, true, Precision>(params.b * x, cos1);
+    vectorSin<Lanes, false, Precision>(params.c * x, sin2);
+    vectorSin<Lanes, true, Precision>(params.d * y, cos2);
+  } else {
+    vectorSin<Lanes, false, Precision>(params.a * y, sin1);
+    vectorSin<Lanes, true, Precision>(params.a * x, cos1);
+    vectorSin<Lanes, false, Precision>(params.b * x, sin2);
+    vectorSin<Lanes, true, Precision>(params.b * y, cos2);
+  }
+
+  // xorshift64 per lane, the top two bits are the smoothing coins for x and y
+  rng ^= rng << 13;
+  rng ^= rng >> 7;
+  rng ^= rng << 17;
+  D coinX = __builtin_convertvector((I)(rng >> 63), D);
+  D coinY = __builtin_convertvector((I)((rng >> 62) & 1), D);
+
+  if (Dejong) {
+    x = sin1 - cos1;
+    y = sin2 - cos2;
+  } else {
+    x = sin1 + params.c * cos1;
+    y = sin2 + params.d * cos2;
+  }
+  x += params.step * (1.0 - 2.0 * coinX);
+  y += params.step * (1.0 - 2.0 * coinY);
+}
+
+template <int Lanes, bool Dejong, TrigPrecision Precision, typename Sink>
+SIMD_INLINE void
+runOrbits(SimdOrbitContext& context, const Sink& sink) {
+  using D = typename Vec<Lanes>::D;
+  using U = typename Vec<Lanes>::U;
+
+  D x, y;
+  U rng;
+  for (int lane = 0; lane < Lanes; lane++) {
+    x[lane] = context.x[lane];
+    y[lane] = context.y[lane];
+    rng[lane] = context.rngState[lane];
+  }
+
+  const OrbitParams params = {
+    context.a, context.b, context.c, context.d, context.smoothingFactor / context.scale
+  };
+  const double scale = context.scale;
+  const double centerX = context.centerX;
+  const double centerY = context.centerY;
+  const double w = context.w;
+  const double h = context.h;
+  uint32_t maxDensity = context.maxDensity;
+
+  for (int i = 0; i < context.burnIn; i++) {
+    advanceOrbits<Lanes, Dejong, Precision>(x, y, rng, params);
+  }
+
+  context.stopped = false;
+  int i = 0;
+  while (i < context.iterations) {
+    const int blockEnd = std::min(context.iterations, i + kKernelPollInterval / Lanes);
+    const int blockStart = i;
+    for (; i < blockEnd; i++) {
+      advanceOrbits<Lanes, Dejong, Precision>(x, y, rng, params);
+      D screenX = centerX + x * scale;
+      D screenY = centerY + y * scale;
+
+      // Scatter, the bounds check on doubles also rejects NaN and out-of-range values
+      for (int lane = 0; lane < Lanes; lane++) {
+        sink.record(x[lane], y[lane]);
+        double sx = screenX[lane];
+        double sy = screenY[lane];
+        if (sx >= 0.0 && sx < w && sy >= 0.0 && sy < h) {
+          uint32_t value = sink.plot(static_cast<int>(sx), static_cast<int>(sy));
+          if (value > maxDensity) {
+            maxDensity = value;
+          }
+        }
+      }
+    }
+
+    if (context.poll.fn &&
+        !context.poll.fn(context.poll.user, (blockEnd - blockStart) * Lanes, maxDensity)) {
+      context.stopped = true;
+      break;
+    }
+  }
+
+  for (int lane = 0; lane < Lanes; lane++) {
+    context.x[lane] = x[lane];
+    context.y[lane] = y[lane];
+    context.rngState[lane] = rng[lane];
+  }
+  context.maxDensity = maxDensity;
+}
+
+template <int Lanes, TrigPrecision Precision, typename Sink>
+SIMD_INLINE void
+runWithPrecision(SimdOrbitContext& context, const Sink& sink) {
+  if (context.dejong) {
+    runOrbits<Lanes, true, Precision>(context, sink);
+  } else {
+    runOrbits<Lanes, false, Precision>(context, sink);
+  }
+}
+
+template <int Lanes, typename Sink>
+SIMD_INLINE void
+runWithMap(SimdOrbitContext& context, const Sink& sink) {
+  switch (context.precision) {
+    case TrigPrecision::EXACT:
+      runWithPrecision<Lanes, TrigPrecision::EXACT>(context, sink);
+      break;
+    case TrigPrecision::FLOAT:
+      runWithPrecision<Lanes, TrigPrecision::FLOAT>(context, sink);
+      break;
+    case TrigPrecision::FAST:
+      runWithPrecision<Lanes, TrigPrecision::FAST>(context, sink);
+      break;
+  }
+}
+
+template <int Lanes, typename Sink>
+SIMD_INLINE void
+runWithSink(SimdOrbitContext& context, const Sink& sink) {
+  if (context.recorder) {
+    OrbitCursor cursor(*context.recorder);
+    runWithMap<Lanes>(context, RecordingSink<Sink>{sink, &cursor});
+  } else {
+    runWithMap<Lanes>(context, sink);
+  }
+}
+
+// Instantiates the kernel for the attractor and the density storage of the context.
+// No lambdas here, they would not inherit the target of the per-ISA entry point.
+template <int Lanes>
+SIMD_INLINE void
+runLanes(SimdOrbitContext& context) {
+  OccupancyMap* occupancy = context.occupancy;
+  OccupancyMap* dirty = context.dirty;
+  if (context.layout == DensityLayout::TILED) {
+    TiledIndex index = {densityTileCount(context.w)};
+    if (context.compact) {
+      runWithSink<Lanes>(
+        context, CompactDensitySink<TiledIndex>{context.compact, index, occupancy, dirty}
+      );
+    } else {
+      runWithSink<Lanes>(
+        context, WideDensitySink<TiledIndex>{context.densityPtr, index, occupancy, dirty}
+      );
+    }
+  } else {
+    RowMajorIndex index = {context.w};
+    if (context.compact) {
+      runWithSink<Lanes>(
+        context, CompactDensitySink<RowMajorIndex>{context.compact, index, occupancy, dirty}
+      );
+    } else {
+      runWithSink<Lanes>(
+        context, WideDensitySink<RowMajorIndex>{context.densityPtr, index, occupancy, dirty}
+      );
+    }
+  }
+}
+
+// Palette colours of Lanes pixels at a time. The lookup itself is a load per lane, the
+// compare against maxDensity and the stores are vector wide.
+template <int Lanes>
+SIMD_INLINE bool
+colorizeDensityLanes(
+  const uint32_t* density,
+  uint32_t* image,
+  size_t count,
+  const uint32_t* colors,
+  uint32_t maxDensity
+) {
+  using U32 = typename Vec<Lanes>::U32;
+  U32 above = {};
+  size_t i = 0;
+  for (; i + Lanes <= count; i += Lanes) {
+    U32 value;
+    std::memcpy(&value, density + i, sizeof(value));
+    U32 tooHigh = (U32)(value > maxDensity);
+    above |= tooHigh;
+    // Densities past the palette read the background, the caller redoes the span anyway
+    U32 index = value & ~tooHigh;
+    U32 color;
+    for (int lane = 0; lane < Lanes; lane++) {
+      color[lane] = colors[index[lane]];
+    }
+    std::memcpy(image + i, &color, sizeof(color));
+  }
+  for (int lane = 0; lane < Lanes; lane++) {
+    if (above[lane]) {
+      return false;
+    }
+  }
+  for (; i < count; i++) {
+    if (density[i] > maxDensity) {
+      return false;
+    }
+    image[i] = colors[density[i]];
+  }
+  return true;
+}
+
+template <int Lanes>
+SIMD_INLINE void
+colorizeFlatLanes(
+  const uint32_t* density,
+  uint32_t* image,
+  size_t count,
+  uint32_t color,
+  uint32_t background
+) {
+  using U32 = typename Vec<Lanes>::U32;
+  size_t i = 0;
+  for (; i + Lanes <= count; i += Lanes) {
+    U32 value;
+    std::memcpy(&value, density + i, sizeof(value));
+    U32 lit = (U32)(value != 0);
+    U32 pixels = (lit & color) | (~lit & background);
+    std::memcpy(image + i, &pixels, sizeof(pixels));
+  }
+  for (; i < count; i++) {
+    image[i] = density[i] ? color : background;
+  }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("avx2,fma"))) void
+runAvx2(SimdOrbitContext& context) {
+  runLanes<8>(context);
+}
+
+__attribute__((target("avx2"))) bool
+colorizeDensityAvx2(
+  const uint32_t* density,
+  uint32_t* image,
+  size_t count,
+  const uint32_t* colors,
+  uint32_t maxDensity
+) {
+  return colorizeDensityLanes<8>(density, image, count, colors, maxDensity);
+}
+
+__attribute__((target("avx2"))) void
+colorizeFlatAvx2(
+  const uint32_t* density,
+  uint32_t* image,
+  size_t count,
+  uint32_t color,
+  uint32_t background
+) {
+  colorizeFlatLanes<8>(density, image, count, color, background);
+}
+
+void
+runSse2(SimdOrbitContext& context) {
+  runLanes<4>(context);
+}
+
+#elif defined(__aarch64__)
+
+void
+runNeon(SimdOrbitContext& context) {
+  runLanes<4>(context);
+}
+
+#endif
+
+}  // namespace
+
+SimdLevel
+detectSimdLevel() {
+#if defined(__x86_64__) || defined(__i386__)
+  static const SimdLevel level = []() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+      return SimdLevel::AVX2;
+    }
+    return SimdLevel::SSE2;
+  }();
+  return level;
+#elif defined(__aarch64__)
+  return SimdLevel::NEON;
+#else
+  return SimdLevel::SCALAR;
+#endif
+}
+
+const char*
+simdLevelName(SimdLevel level) {
+  switch (level) {
+    case SimdLevel::SSE2:
+      return "sse2";
+    case SimdLevel::AVX2:
+      return "avx2";
+    case SimdLevel::NEON:
+      return "neon";
+    case SimdLevel::SCALAR:
+      break;
+  }
+  return "scalar";
+}
+
+bool
+colorizeDensity(
+  SimdLevel level,
+  const uint32_t* density,
+  uint32_t* image,
+  size_t count,
+  const uint32_t* colors,
+  uint32_t maxDensity
+) {
+#if defined(__x86_64__) || defined(__i386__)
+  if (level == SimdLevel::AVX2) {
+    return colorizeDensityAvx2(density, image, count, colors, maxDensity);
+  }
+#endif
+  return colorizeDensityLanes<4>(density, image, count, colors, maxDensity);
+}
+
+void
+colorizeFlat(
+  SimdLevel level,
+  const uint32_t* density,
+  uint32_t* image,
+  size_t count,
+  uint32_t color,
+  uint32_t background
+) {
+#if defined(__x86_64__) || defined(__i386__)
+  if (level == SimdLevel::AVX2) {
+    colorizeFlatAvx2(density, image, count, color, background);
+    return;
+  }
+#endif
+  colorizeFlatLanes<4>(density, image, count, color, background);
+}
+
+int
+simdLaneCount(SimdLevel level) {
+  switch (level) {
+    case SimdLevel::AVX2:
+      return 8;
+    case SimdLevel::SSE2:
+    case SimdLevel::NEON:
+      return 4;
+    case SimdLevel::SCALAR:
+      break;
+  }
+  return 1;
+}
+
+void
+accumulateDensitySimd(SimdLevel level, SimdOrbitContext& context) {
+  switch (level) {
+#if defined(__x86_64__) || defined(__i386__)
+    case SimdLevel::AVX2:
+      runAvx2(context);
+      break;
+    case SimdLevel::SSE2:
+      runSse2(context);
+      break;
+#elif defined(__aarch64__)
+    case SimdLevel::NEON:
+      runNeon(context);
+      break;
+#endif
+    default:
+      break;
+  }
+}
+
+}  // namespace facebook::react
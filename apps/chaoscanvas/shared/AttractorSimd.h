@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "DensityLayout.h"
+#include "FastTrig.h"
+
+namespace facebook::react {
+
+class CompactDensity;
+class OccupancyMap;
+class OrbitRecorder;
+
+// Vector instruction set used by the multi-orbit kernel, detected at runtime.
+// NEON means arm64, 32-bit ARM has no double-precision NEON and stays SCALAR.
+enum class SimdLevel { SCALAR, SSE2, AVX2, NEON };
+
+SimdLevel detectSimdLevel();
+const char* simdLevelName(SimdLevel level);
+
+// Orbits advanced together by the kernel of the given level, 1 for SCALAR
+int simdLaneCount(SimdLevel level);
+
+// Hook the kernels call between blocks of points, with the points plotted since the last
+// call and the running max density. Returning false stops the orbit.
+struct KernelPoll {
+  bool (*fn)(void* user, int points, uint32_t maxDensity) = nullptr;
+  void* user = nullptr;
+};
+
+// Points a kernel plots between two polls
+constexpr int kKernelPollInterval = 65536;
+
+// State for a group of independent orbits advanced in SIMD lanes.
+// Every lane plots into the same density buffer.
+struct SimdOrbitContext {
+  uint32_t* densityPtr;
+  CompactDensity* compact;   // replaces densityPtr when set
+  OccupancyMap* occupancy;   // marked as points land when set
+  OccupancyMap* dirty;       // marked on every point when set
+  OrbitRecorder* recorder;   // keeps every plotted point when set
+  int w;
+  int h;
+  DensityLayout layout;
+  double a;
+  double b;
+  double c;
+  double d;
+  double scale;
+  double smoothingFactor;
+  double centerX;
+  double centerY;
+  bool dejong;
+  TrigPrecision precision;
+  double* x;           // one per lane, updated in place
+  double* y;           // one per lane, updated in place
+  uint64_t* rngState;  // one xorshift state per lane, must not be 0
+  int iterations;      // points plotted by each lane
+  int burnIn;          // iterations each lane runs before it starts plotting
+  uint32_t maxDensity;  // in/out
+  KernelPoll poll;
+  bool stopped;  // out, set when the poll stopped the lanes early
+};
+
+// Advances simdLaneCount(level) orbits with vectorized sin/cos, then scatters
+// the lane results into the density buffer. Must not be called with SCALAR.
+void accumulateDensitySimd(SimdLevel level, SimdOrbitContext& context);
+
+// Colours count pixels through a palette indexed by density, colors[0] being the
+// background. Returns false when a density is above maxDensity, the span is then only
+// partly right and has to be coloured another way. Any level, SCALAR included, runs the
+// vector code of the build target (SSE2, NEON, WASM SIMD) or plain code without one.
+bool colorizeDensity(
+  SimdLevel level,
+  const uint32_t* density,
+  uint32_t* image,
+  size_t count,
+  const uint32_t* colors,
+  uint32_t maxDensity
+);
+
+// Colours count pixels with color where the density isn't 0, background elsewhere
+void colorizeFlat(
+  SimdLevel level,
+  const uint32_t* density,
+  uint32_t* image,
+  size_t count,
+  uint32_t color,
+  uint32_t background
+);
+
+}  // namespace facebook::react
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+namespace facebook::react {
+
+// Sizes chunks of points to a wall-clock budget instead of a fixed count.
+//
+// The caller runs nextChunk() points, reports how long they took with record(), and asks
+// shouldDraw() whether a redraw is due for the target frame rate. Throughput is a moving
+// average, so one slow chunk (a GC pause, a thermal dip) doesn't halve the next one.
+class ChunkScheduler {
+ public:
+  // Chunk size before the first measurement, small enough for any device
+  static constexpr int kInitialChunk = 20000;
+  static constexpr int kMinChunk = 1000;
+  // A chunk grows at most this much over the last one, in case the first
+  // measurements were too optimistic
+  static constexpr double kMaxGrowth = 4.0;
+
+  ChunkScheduler(double budgetMs, double targetFps)
+      : budgetMs_(std::max(0.1, budgetMs)),
+        frameMs_(targetFps > 0 ? 1000.0 / targetFps : 0) {}
+
+  // Points to run next, never more than remaining
+  int
+  nextChunk(int64_t remaining) const {
+    double points = kInitialChunk;
+    if (pointsPerMs_ > 0) {
+      points = pointsPerMs_ * budgetMs_;
+      points = std::min(points, lastChunk_ * kMaxGrowth);
+    }
+    points = std::min<double>(points, std::numeric_limits<int>::max());
+    points = std::max<double>(points, kMinChunk);
+    return static_cast<int>(std::min<int64_t>(remaining, static_cast<int64_t>(points)));
+  }
+
+  // Feeds back how long a chunk from nextChunk() took
+  void
+  record(int points, double elapsedMs) {
+    lastChunk_ = std::max(points, kMinChunk);
+    if (points <= 0) {
+      return;
+    }
+    double rate = points / std::max(elapsedMs, 0.01);
+    pointsPerMs_ = pointsPerMs_ > 0 ? pointsPerMs_ + (rate - pointsPerMs_) * kSmoothing : rate;
+  }
+
+  // True once per frame interval, the first call at nowMs always draws
+  bool
+  shouldDraw(double nowMs) {
+    if (lastDrawMs_ >= 0 && nowMs - lastDrawMs_ < frameMs_) {
+      return false;
+    }
+    lastDrawMs_ = nowMs;
+    return true;
+  }
+
+  double
+  pointsPerMs() const {
+    return pointsPerMs_;
+  }
+
+ private:
+  // Weight of the newest chunk in the throughput average
+  static constexpr double kSmoothing = 0.3;
+
+  double budgetMs_;
+  double frameMs_;
+  double pointsPerMs_ = 0;
+  int lastChunk_ = kInitialChunk;
+  double lastDrawMs_ = -1;
+};
+
+}  // namespace facebook::react
@@ -0,0 +1,56 @@
+#include "CompactDensity.h"
+
+#include <algorithm>
+
+namespace facebook::react {
+
+CompactDensity::CompactDensity(size_t size)
+    : low_(size, 0), high_((size + kBlockMask) >> kBlockShift) {}
+
+uint16_t*
+CompactDensity::promote(size_t block) {
+  if (!high_[block]) {
+    high_[block] = std::make_unique<uint16_t[]>(kBlockSize);  // zero-initialized
+  }
+  return high_[block].get();
+}
+
+uint16_t*
+CompactDensity::carry(size_t i) {
+  uint16_t* high = promote(i >> kBlockShift);
+  high[i & kBlockMask]++;
+  return high;
+}
+
+void
+CompactDensity::set(size_t i, uint32_t value) {
+  low_[i] = static_cast<uint16_t>(value);
+  uint16_t* high = high_[i >> kBlockShift].get();
+  if (value > 0xffff && !high) {
+    high = promote(i >> kBlockShift);
+  }
+  if (high) {
+    high[i & kBlockMask] = static_cast<uint16_t>(value >> 16);
+  }
+}
+
+void
+CompactDensity::clear() {
+  std::fill(low_.begin(), low_.end(), 0);
+  for (auto& high : high_) {
+    high.reset();
+  }
+}
+
+size_t
+CompactDensity::promotedBlocks() const {
+  return std::count_if(high_.begin(), high_.end(), [](const auto& high) { return !!high; });
+}
+
+size_t
+CompactDensity::bytes() const {
+  return low_.size() * sizeof(uint16_t) + high_.size() * sizeof(high_[0]) +
+    promotedBlocks() * kBlockSize * sizeof(uint16_t);
+}
+
+}  // namespace facebook::react
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "DensityLayout.h"
+#include "OccupancyMap.h"
+
+namespace facebook::react {
+
+// Density counters stored in 16 bits.
+//
+// Most pixels of a render stay far below 65535, so only the low halves are stored for
+// every pixel. The high halves are kept per block of 4096 counters, allocated the first
+// time a counter of the block carries past 65535. The scatter loop then moves half the
+// bytes of a uint32_t buffer, and the hot blocks cost 8 KB each on top.
+class CompactDensity {
+ public:
+  static constexpr int kBlockShift = 12;
+  static constexpr size_t kBlockSize = size_t(1) << kBlockShift;
+  static constexpr size_t kBlockMask = kBlockSize - 1;
+
+  explicit CompactDensity(size_t size);
+
+  size_t
+  size() const {
+    return low_.size();
+  }
+
+  // Adds one to counter i and returns its new value
+  uint32_t
+  increment(size_t i) {
+    uint16_t low = ++low_[i];
+    uint16_t* high = high_[i >> kBlockShift].get();
+    if (low == 0) {
+      high = carry(i);
+    }
+    return high ? (static_cast<uint32_t>(high[i & kBlockMask]) << 16) | low : low;
+  }
+
+  uint32_t
+  get(size_t i) const {
+    const uint16_t* high = high_[i >> kBlockShift].get();
+    return high ? (static_cast<uint32_t>(high[i & kBlockMask]) << 16) | low_[i] : low_[i];
+  }
+
+  // Not safe against a concurrent set() in the same block
+  void set(size_t i, uint32_t value);
+  void clear();
+
+  // Blocks that needed their high halves
+  size_t promotedBlocks() const;
+  size_t bytes() const;
+
+ private:
+  uint16_t* carry(size_t i);
+  uint16_t* promote(size_t block);
+
+  std::vector<uint16_t> low_;
+  std::vector<std::unique_ptr<uint16_t[]>> high_;
+};
+
+// Where the kernels plot: a uint32_t buffer or compact counters, in either layout.
+// plot() returns the new density of the pixel. It marks the tile of a pixel's first
+// point in the occupancy map and the tile of every point in the dirty map, for the maps
+// there are. The kernels pass every point of the orbit to record(), which only
+// RecordingSink (OrbitRecorder.h) keeps.
+template <typename Index>
+struct WideDensitySink {
+  uint32_t* densityPtr;
+  Index index;
+  OccupancyMap* occupancy = nullptr;
+  OccupancyMap* dirty = nullptr;
+
+  uint32_t
+  plot(int x, int y) const {
+    uint32_t value = ++densityPtr[index(x, y)];
+    if (value == 1 && occupancy) {
+      occupancy->mark(x, y);
+    }
+    if (dirty) {
+      dirty->mark(x, y);
+    }
+    return value;
+  }
+
+  void
+  record(double, double) const {}
+};
+
+template <typename Index>
+struct CompactDensitySink {
+  CompactDensity* density;
+  Index index;
+  OccupancyMap* occupancy = nullptr;
+  OccupancyMap* dirty = nullptr;
+
+  uint32_t
+  plot(int x, int y) const {
+    uint32_t value = density->increment(index(x, y));
+    if (value == 1 && occupancy) {
+      occupancy->mark(x, y);
+    }
+    if (dirty) {
+      dirty->mark(x, y);
+    }
+    return value;
+  }
+
+  void
+  record(double, double) const {}
+};
+
+// Calls fn(sink) with the sink for a wide buffer (compact null) or compact counters,
+// marking the maps that aren't null
+template <typename Fn>
+inline void
+withDensitySink(
+  uint32_t* densityPtr,
+  CompactDensity* compact,
+  OccupancyMap* occupancy,
+  OccupancyMap* dirty,
+  DensityLayout layout,
+  int w,
+  Fn&& fn
+) {
+  if (layout == DensityLayout::TILED) {
+    TiledIndex index = {densityTileCount(w)};
+    if (compact) {
+      fn(CompactDensitySink<TiledIndex>{compact, index, occupancy, dirty});
+    } else {
+      fn(WideDensitySink<TiledIndex>{densityPtr, index, occupancy, dirty});
+    }
+  } else {
+    RowMajorIndex index = {w};
+    if (compact) {
+      fn(CompactDensitySink<RowMajorIndex>{compact, index, occupancy, dirty});
+    } else {
+      fn(WideDensitySink<RowMajorIndex>{densityPtr, index, occupancy, dirty});
+    }
+  }
+}
+
+}  // namespace facebook::react
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace facebook::react {
+
+// Tells when more points stop changing the picture.
+//
+// A fixed set of pixels is sampled as log density, the scale the palette colours by.
+// Whenever the point count has doubled since the last snapshot, the samples are scaled
+// back to the snapshot's point count and compared with it: the mean difference, relative
+// to the log of the max density, is what doubling the work changed apart from the overall
+// brightening. It falls like the Monte Carlo noise and below the threshold the render
+// counts as converged. Comparing doublings instead of consecutive redraws keeps the
+// metric independent of how often it is checked.
+class ConvergenceTracker {
+ public:
+  static constexpr int kSampleCount = 16384;
+
+  // threshold is the mean log density change per visible sample, over log max density
+  explicit ConvergenceTracker(double threshold) : threshold_(threshold) {}
+
+  // Samples density(i) for i in [0, size) after pointsDone points of the render.
+  // Returns true when this call finished a doubling that changed less than the threshold.
+  template <typename Density>
+  bool
+  update(const Density& density, size_t size, uint32_t maxDensity, int64_t pointsDone) {
+    if (converged_ || size == 0 || maxDensity == 0 || pointsDone <= 0 ||
+        (referencePoints_ > 0 && pointsDone < 2 * referencePoints_)) {
+      return false;
+    }
+
+    current_.resize(kSampleCount);
+    for (int k = 0; k < kSampleCount; k++) {
+      current_[k] = density(sampleIndex(k, size));
+    }
+
+    if (referencePoints_ > 0) {
+      double scale = static_cast<double>(referencePoints_) / pointsDone;
+      double logMax = std::log1p(maxDensity * scale);
+      double changed = 0;
+      int visible = 0;
+      for (int k = 0; k < kSampleCount; k++) {
+        if (current_[k] != 0 || reference_[k] != 0) {
+          changed += std::abs(std::log1p(current_[k] * scale) - std::log1p(reference_[k]));
+          visible++;
+        }
+      }
+      change_ = visible > 0 ? changed / (visible * logMax) : 1.0;
+      // An empty or near empty sample says nothing yet
+      converged_ = visible >= kMinVisibleSamples && change_ < threshold_;
+    }
+    reference_.swap(current_);
+    referencePoints_ = pointsDone;
+    return converged_;
+  }
+
+  bool
+  converged() const {
+    return converged_;
+  }
+
+  // Relative change of the last doubling, 1 before the first one
+  double
+  change() const {
+    return change_;
+  }
+
+ private:
+  // Samples that must be visible before the metric is trusted
+  static constexpr int kMinVisibleSamples = 64;
+
+  // Evenly spread with a hashed offset inside each stride, so the samples don't line up
+  // with the columns of the image
+  static size_t
+  sampleIndex(int k, size_t size) {
+    double stride = static_cast<double>(size) / kSampleCount;
+    uint32_t hash = static_cast<uint32_t>(k) * 2654435761u;
+    double offset = (hash >> 8) / static_cast<double>(1u << 24) * stride;
+    return std::min(size - 1, static_cast<size_t>(k * stride + offset));
+  }
+
+  double threshold_;
+  bool converged_ = false;
+  double change_ = 1.0;
+  int64_t referencePoints_ = 0;
+  std::vector<uint32_t> reference_;
+  std::vector<uint32_t> current_;
+};
+
+}  // namespace facebook::react
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace facebook::react {
+
+// Memory order of a density buffer.
+//
+// ROW_MAJOR is the py * w + px layout the app shares with JS. TILED stores 64x64 tiles
+// one after the other, so the clustered points of an orbit stay within a few pages; it
+// pays off once the buffer is far bigger than the caches, e.g. for print renders.
+enum class DensityLayout { ROW_MAJOR, TILED };
+
+constexpr int kDensityTileShift = 6;
+constexpr int kDensityTileSize = 1 << kDensityTileShift;
+constexpr int kDensityTileMask = kDensityTileSize - 1;
+constexpr size_t kDensityTileArea = kDensityTileSize * kDensityTileSize;
+
+inline int
+densityTileCount(int pixels) {
+  return (pixels + kDensityTileMask) >> kDensityTileShift;
+}
+
+// Elements a density buffer of the layout needs, tiles are padded to full size
+inline size_t
+densityBufferSize(DensityLayout layout, int w, int h) {
+  if (layout == DensityLayout::TILED) {
+    return static_cast<size_t>(densityTileCount(w)) * densityTileCount(h) * kDensityTileArea;
+  }
+  return static_cast<size_t>(w) * h;
+}
+
+// Pixel to buffer index, passed to the kernels as a template argument
+struct RowMajorIndex {
+  int stride;
+
+  size_t
+  operator()(int x, int y) const {
+    return static_cast<size_t>(y) * stride + x;
+  }
+};
+
+struct TiledIndex {
+  int tilesPerRow;
+
+  size_t
+  operator()(int x, int y) const {
+    size_t tile = static_cast<size_t>(y >> kDensityTileShift) * tilesPerRow +
+      (x >> kDensityTileShift);
+    return tile * kDensityTileArea + ((y & kDensityTileMask) << kDensityTileShift) +
+      (x & kDensityTileMask);
+  }
+};
+
+}  // namespace facebook::react
@@ -0,0 +1,133 @@
+#include "DensityPyramid.h"
+
+#include <algorithm>
+
+namespace facebook::react {
+
+namespace {
+
+// Sums 2x2 pixels of columns x0 to x1 of a width x height density, read(i) being its
+// pixel i, into rows y0 to y1 of dst and returns their max. An odd last row or column
+// sums the pixels it has.
+template <typename Read>
+uint32_t
+downsample(
+  const Read& read,
+  int width,
+  int height,
+  uint32_t* dst,
+  int x0,
+  int x1,
+  int y0,
+  int y1
+) {
+  int dstWidth = DensityPyramid::levelSize(width, 1);
+  int pairs = std::min(x1, width >> 1);
+  uint32_t maxDensity = 0;
+  for (int y = y0; y < y1; y++) {
+    size_t top = static_cast<size_t>(2 * y) * width;
+    // The last row of an odd height has no row below it
+    bool hasBottom = 2 * y + 1 < height;
+    size_t bottom = top + width;
+    uint32_t* out = dst + static_cast<size_t>(y) * dstWidth;
+    for (int x = x0; x < pairs; x++) {
+      uint32_t sum = read(top + 2 * x) + read(top + 2 * x + 1);
+      if (hasBottom) {
+        sum += read(bottom + 2 * x) + read(bottom + 2 * x + 1);
+      }
+      out[x] = sum;
+      maxDensity = std::max(maxDensity, sum);
+    }
+    if (pairs < x1) {
+      uint32_t sum = read(top + width - 1) + (hasBottom ? read(bottom + width - 1) : 0);
+      out[pairs] = sum;
+      maxDensity = std::max(maxDensity, sum);
+    }
+  }
+  return maxDensity;
+}
+
+}  // namespace
+
+DensityPyramid::DensityPyramid(int width, int height)
+    : width_(std::max(0, width)), height_(std::max(0, height)) {
+  for (int level = 1; level <= kMaxLevel; level++) {
+    levels_[level - 1].resize(
+      static_cast<size_t>(levelSize(width_, level)) * levelSize(height_, level)
+    );
+  }
+}
+
+int
+DensityPyramid::previewLevel(int64_t pointsDone, int width, int height) {
+  for (int level = 0; level < kMaxLevel; level++) {
+    int64_t pixels = static_cast<int64_t>(levelSize(width, level)) * levelSize(height, level);
+    if (pointsDone >= pixels) {
+      return level;
+    }
+  }
+  return kMaxLevel;
+}
+
+uint32_t
+DensityPyramid::build(const uint32_t* density, int level, const OccupancyMap* occupancy) {
+  return buildFrom([density](size_t i) { return density[i]; }, level, occupancy);
+}
+
+uint32_t
+DensityPyramid::build(const CompactDensity& density, int level, const OccupancyMap* occupancy) {
+  return buildFrom([&density](size_t i) { return density.get(i); }, level, occupancy);
+}
+
+template <typename Read>
+uint32_t
+DensityPyramid::buildFrom(const Read& density, int level, const OccupancyMap* occupancy) {
+  if (level < 1) {
+    return 0;
+  }
+  // The full density is the one worth skipping tiles of, the other levels are a quarter
+  // of the size and less
+  uint32_t maxDensity = 0;
+  uint32_t* first = levels_[0].data();
+  int firstWidth = levelSize(width_, 1);
+  int firstHeight = levelSize(height_, 1);
+  if (occupancy) {
+    const int tileSize = kDensityTileSize >> 1;
+    for (int tileY = 0; tileY < occupancy->tileRows(); tileY++) {
+      int y0 = tileY * tileSize;
+      int y1 = std::min(y0 + tileSize, firstHeight);
+      occupancy->forEachRun(tileY, [&](int tileX, int endTileX, bool marked) {
+        int x0 = tileX * tileSize;
+        int x1 = std::min(endTileX * tileSize, firstWidth);
+        if (marked) {
+          maxDensity =
+            std::max(maxDensity, downsample(density, width_, height_, first, x0, x1, y0, y1));
+          return;
+        }
+        for (int y = y0; y < y1; y++) {
+          std::fill_n(first + static_cast<size_t>(y) * firstWidth + x0, x1 - x0, 0);
+        }
+      });
+    }
+  } else {
+    maxDensity = downsample(density, width_, height_, first, 0, firstWidth, 0, firstHeight);
+  }
+  for (int l = 2; l <= std::min(level, kMaxLevel); l++) {
+    int srcWidth = levelSize(width_, l - 1);
+    int srcHeight = levelSize(height_, l - 1);
+    const uint32_t* src = levels_[l - 2].data();
+    maxDensity = downsample(
+      [src](size_t i) { return src[i]; },
+      srcWidth,
+      srcHeight,
+      levels_[l - 1].data(),
+      0,
+      levelSize(srcWidth, 1),
+      0,
+      levelSize(srcHeight, 1)
+    );
+  }
+  return maxDensity;
+}
+
+}  // namespace facebook::react
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "CompactDensity.h"
+#include "OccupancyMap.h"
+
+namespace facebook::react {
+
+// Coarser copies of a row-major density for the first frames of a render, each level
+// summing 2x2 pixels of the one below: level 1 is half the size, 2 a quarter and 3 an
+// eighth. A few thousand points already fill the 1/8 level, which coloured and scaled
+// up shows the shape long before the full resolution density stops looking like noise.
+//
+// The levels are summed from the full density when a frame needs them instead of being
+// plotted alongside it, so the kernels pay nothing for them.
+class DensityPyramid {
+ public:
+  static constexpr int kMaxLevel = 3;
+
+  DensityPyramid() = default;
+  DensityPyramid(int width, int height);
+
+  int
+  width() const {
+    return width_;
+  }
+
+  int
+  height() const {
+    return height_;
+  }
+
+  // Pixels of a level along a side of size pixels, rounded up so the last row and
+  // column keep their points
+  static int
+  levelSize(int size, int level) {
+    return (size + (1 << level) - 1) >> level;
+  }
+
+  // Level a frame of pointsDone points on a width x height canvas is coloured from: the
+  // finest with about a point per pixel, 0 for the full density
+  static int previewLevel(int64_t pointsDone, int width, int height);
+
+  // Sums the full density, uint32_t or compact counters, into levels 1 to level and
+  // returns the max density of level. The clear tiles of occupancy, when there is one,
+  // are not read.
+  uint32_t build(const uint32_t* density, int level, const OccupancyMap* occupancy = nullptr);
+  uint32_t
+  build(const CompactDensity& density, int level, const OccupancyMap* occupancy = nullptr);
+
+  // levelSize(width, level) x levelSize(height, level) densities, after build() went
+  // down to it
+  const uint32_t*
+  level(int level) const {
+    return levels_[level - 1].data();
+  }
+
+ private:
+  template <typename Read>
+  uint32_t buildFrom(const Read& density, int level, const OccupancyMap* occupancy);
+
+  int width_ = 0;
+  int height_ = 0;
+  std::vector<uint32_t> levels_[kMaxLevel];
+};
+
+}  // namespace facebook::react
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace facebook::react {
+
+// Accuracy of the sin and cos in the attractor maps. Points are truncated to whole pixels
+// and moved by the smoothing offset, a fifth of a pixel, so the last digits of a double
+// sin never show, and the cheaper tiers trade them for speed. The orbit is chaotic: any
+// tier gives another orbit on the same attractor, and the same density up to noise.
+// Max absolute error against the exact sin for |x| < 64, tests/TrigPrecisionTest.cpp
+// checks these:
+//   EXACT  libm, the SIMD kernel the fdlibm polynomials, below 1 ulp
+//   FLOAT  float32 sinf/cosf, the SIMD kernel shorter polynomials in double, 2e-6
+//          (the argument's float rounding, 3.3e-8 for the polynomials)
+//   FAST   range reduction by pi/2 and polynomials of degree 5 and 4, 1.3e-5
+enum class TrigPrecision { EXACT, FLOAT, FAST };
+
+// "exact", "float" or "fast", nullopt for anything else
+inline std::optional<TrigPrecision>
+parseTrigPrecision(const std::string& name) {
+  if (name == "exact") {
+    return TrigPrecision::EXACT;
+  }
+  if (name == "float") {
+    return TrigPrecision::FLOAT;
+  }
+  if (name == "fast") {
+    return TrigPrecision::FAST;
+  }
+  return std::nullopt;
+}
+
+inline const char*
+trigPrecisionName(TrigPrecision precision) {
+  switch (precision) {
+    case TrigPrecision::FLOAT:
+      return "float";
+    case TrigPrecision::FAST:
+      return "fast";
+    case TrigPrecision::EXACT:
+      break;
+  }
+  return "exact";
+}
+
+// Range reduction by pi/2 in two parts (fdlibm), exact enough for the |x| < 100 we see
+constexpr double kTwoOverPi = 6.36619772367581382433e-01;
+constexpr double kPio2Hi = 1.57079632673412561417e+00;
+constexpr double kPio2Lo = 6.07710050650619224932e-11;
+// Adding and subtracting 1.5 * 2^52 rounds a double to the nearest integer
+constexpr double kRoundMagic = 6755399441055744.0;
+
+// Minimax polynomials on [-pi/4, pi/4]: sin r = r + r^3 (S1 + S2 r^2 ...) and
+// cos r = 1 + r^2 (C1 + C2 r^2 ...). FAST errors 9.4e-7 and 1.3e-5, FLOAT 1.8e-9 and 3.3e-8.
+constexpr double kFastS1 = -1.66628338069317930e-01;
+constexpr double kFastS2 = 8.15299234181447900e-03;
+constexpr double kFastC1 = -4.99776307076169300e-01;
+constexpr double kFastC2 = 4.04889358435944500e-02;
+constexpr double kFloatS1 = -1.66666506692942060e-01;
+constexpr double kFloatS2 = 8.33197866315696200e-03;
+constexpr double kFloatS3 = -1.94956362375691450e-04;
+constexpr double kFloatC1 = -4.99998947813713200e-01;
+constexpr double kFloatC2 = 4.16562945784856200e-02;
+constexpr double kFloatC3 = -1.35978231117334530e-03;
+
+// sin(x), or cos(x) as sin(x + pi/2), with the FAST polynomials
+template <bool Cosine>
+inline double
+fastSin(double x) {
+  double quadrantD = (x * kTwoOverPi + kRoundMagic) - kRoundMagic;
+  int64_t quadrant = static_cast<int64_t>(quadrantD) + (Cosine ? 1 : 0);
+  double r = (x - quadrantD * kPio2Hi) - quadrantD * kPio2Lo;
+  double z = r * r;
+  // Odd quadrants use the cosine polynomial, quadrants 2 and 3 flip the sign
+  double value = (quadrant & 1) ? 1.0 + z * (kFastC1 + z * kFastC2)
+                                : r + r * z * (kFastS1 + z * kFastS2);
+  return (quadrant & 2) ? -value : value;
+}
+
+template <TrigPrecision precision>
+inline double
+trigSin(double x) {
+  if constexpr (precision == TrigPrecision::FAST) {
+    return fastSin<false>(x);
+  } else if constexpr (precision == TrigPrecision::FLOAT) {
+    return std::sin(static_cast<float>(x));
+  } else {
+    return std::sin(x);
+  }
+}
+
+template <TrigPrecision precision>
+inline double
+trigCos(double x) {
+  if constexpr (precision == TrigPrecision::FAST) {
+    return fastSin<true>(x);
+  } else if constexpr (precision == TrigPrecision::FLOAT) {
+    return std::cos(static_cast<float>(x));
+  } else {
+    return std::cos(x);
+  }
+}
+
+}  // namespace facebook::react
@@ -1,4 +1,6 @@
 #include "NativeAttractorCalc.h"
+#include "ChunkScheduler.h"
+#include "ConvergenceTracker.h"
 // #include "attractors.h"
 #include <jsi/jsi.h>
 
@@ -6,7 +8,10 @@
 #include <atomic>
 #include <chrono>
 #include <cmath>
+#include <cstdio>
 #include <functional>
+#include <limits>
+#include <random>
 #include <thread>
 #include <tuple>
 #include <vector>
@@ -15,180 +20,6 @@ namespace facebook::react {
 
 std::string version = "2.0.1";
 
-// A C++ implementation of the BezierEasing function from the original JS.
-// It returns a lambda function that calculates the easing.
-std::function<double(double)>
-NativeAttractorCalc::bezierEasing(double p0, double p1, double p2, double p3) {
-  // Define these functions to match the JavaScript implementation exactly
-  // All captures are by value [=] to ensure they work properly when returned
-
-  // These can be static since they don't depend on the parameters
-  auto A = [](double aA1, double aA2) { return 1.0 - 3.0 * aA2 + 3.0 * aA1; };
-  auto B = [](double aA1, double aA2) { return 3.0 * aA2 - 6.0 * aA1; };
-  auto C = [](double aA1) { return 3.0 * aA1; };
-
-  // This needs to capture the A, B, C functions
-  auto calc_bezier = [=](double t, double aA1, double aA2) {
-    return ((A(aA1, aA2) * t + B(aA1, aA2)) * t + C(aA1)) * t;
-  };
-
-  // This needs to capture the A, B, C functions
-  auto get_slope = [=](double t, double aA1, double aA2) {
-    return 3.0 * A(aA1, aA2) * t * t + 2.0 * B(aA1, aA2) * t + C(aA1);
-  };
-
-  // Capture everything by value to match JS implementation exactly
-  auto get_t_for_x = [=](double aX) {
-    double aGuessT = aX;
-    for (int i = 0; i < 4; ++i) {
-      double currentSlope = get_slope(aGuessT, p0, p2);
-      if (currentSlope == 0.0) {
-        return aGuessT;
-      }
-      double currentX = calc_bezier(aGuessT, p0, p2) - aX;
-      aGuessT -= currentX / currentSlope;
-    }
-    return aGuessT;
-  };
-
-  // Return the final function with everything captured by value
-  return [=](double x) {
-    if (x <= 0.0) {
-      return 0.0;
-    }
-    if (x >= 1.0) {
-      return 1.0;
-    }
-    return calc_bezier(get_t_for_x(x), p1, p3);
-  };
-}
-
-RGB
-NativeAttractorCalc::hsvToRgb(double h, double s, double v) {
-  // Exactly match JavaScript hsv2rgb implementation
-  // Clamp input values to valid ranges
-  h = std::max(0.0, std::min(359.0, h));
-  s = std::max(0.0, std::min(100.0, s));
-  v = std::max(0.0, std::min(100.0, v));
-
-  // Normalize s and v to 0-1 range
-  s /= 100.0;
-  v /= 100.0;
-
-  // Handle grayscale case (s === 0)
-  if (s == 0.0) {
-    int val = std::round(v * 255);
-    return {val, val, val};
-  }
-
-  // Convert hue to sector (0-5)
-  h /= 60.0;
-  int i = std::floor(h);
-  double f = h - i;
-
-  // Calculate color components
-  double p = v * (1.0 - s);
-  double q = v * (1.0 - s * f);
-  double t = v * (1.0 - s * (1 - f));
-
-  // Assign RGB based on hue sector
-  double r, g, b;
-  switch (i) {
-    case 0:
-      r = v;
-      g = t;
-      b = p;
-      break;
-    case 1:
-      r = q;
-      g = v;
-      b = p;
-      break;
-    case 2:
-      r = p;
-      g = v;
-      b = t;
-      break;
-    case 3:
-      r = p;
-      g = q;
-      b = v;
-      break;
-    case 4:
-      r = t;
-      g = p;
-      b = v;
-      break;
-    default:
-      r = v;
-      g = p;
-      b = q;
-      break;  // Handles case 5 and any overflow
-  }
-
-  // Return RGB values scaled to 0-255 range and rounded to integers
-  return {
-    static_cast<int>(std::round(r * 255)),
-    static_cast<int>(std::round(g * 255)),
-    static_cast<int>(std::round(b * 255))
-  };
-}
-
-uint32_t
-NativeAttractorCalc::getColorData(
-  double density,
-  double maxDensity,
-  double h,
-  double s,
-  double v,
-  double progress,
-  const std::vector<int>& background
-) {
-  // Exactly match JavaScript behavior
-  if (density <= 0) {
-    return 0;
-  }
-
-  // Prevent log(1) = 0 or log of negative/zero numbers
-  if (maxDensity <= 1.0) {
-    maxDensity = 1.01;
-  }
-
-  auto saturation_bezier = bezierEasing(0.79, -0.34, 0.54, 1.18);
-  auto density_bezier = bezierEasing(0.75, 0.38, 0.24, 1.33);
-  auto opacity_bezier = bezierEasing(0.24, 0.27, 0.13, 0.89);
-
-  // Match JS exactly - first calculate log values
-  double mdens = std::log(maxDensity);
-  double pdens = std::log(density);
-
-  // Match JS hsv2rgb call exactly
-  double satFactor = std::max(0.0, std::min(1.0, saturation_bezier(pdens / mdens)));
-  RGB rgb = hsvToRgb(h, s - satFactor * s, v);
-
-  // Match JS density_alpha calculation exactly
-  double density_alpha = std::max(0.0, std::min(1.0, density_bezier(pdens / mdens)));
-
-  // Get background color components with defaults matching JS behavior
-  // In JS: (background && background[0]) || 0
-  int bgR = background.size() > 0 ? background[0] : 0;
-  int bgG = background.size() > 1 ? background[1] : 0;
-  int bgB = background.size() > 2 ? background[2] : 0;
-
-  // Blend colors based on density_alpha exactly as JS does
-  int blendedR = std::round(rgb.r * density_alpha + bgR * (1 - density_alpha));
-  int blendedG = std::round(rgb.g * density_alpha + bgG * (1 - density_alpha));
-  int blendedB = std::round(rgb.b * density_alpha + bgB * (1 - density_alpha));
-
-  // Match JS exactly: opacityBezier(progress || 1)
-  double effectiveProgress = progress <= 0 ? 1.0 : progress;
-  uint32_t alpha = static_cast<uint32_t>(std::round(opacity_bezier(effectiveProgress) * 255));
-
-  // Match JS bit-shifting pattern exactly
-  return (alpha << 24) | (static_cast<uint32_t>(blendedB) << 16) |
-    (static_cast<uint32_t>(blendedG) << 8) | static_cast<uint32_t>(blendedR);
-}
-
 double
 NativeAttractorCalc::ratePerformance(jsi::Runtime& rt) {
   const int num_iterations = 10000000;  // 10 million iterations for a quicker test
@@ -233,183 +64,309 @@ NativeAttractorCalc::getBuildNumber(jsi::Runtime& rt) {
   return version;
 }
 
-uint32_t
-NativeAttractorCalc::getLowQualityPoint(double hue, double saturation, double brightness) {
-  RGB rgb = hsvToRgb(hue, saturation, brightness);
-  return (255 << 24) | (rgb.b << 16) | (rgb.g << 8) | rgb.r;
-}
-
-double
-NativeAttractorCalc::smoothing(double num, double scale) {
-  const double factor = 0.222;
-  // Use C++ random to match JavaScript's Math.random() < 0.5 behavior
-  return num +
-    (static_cast<double>(std::rand()) / RAND_MAX < 0.5 ? -factor : factor) * (1.0 / scale);
-}
+// Calculation jobs that may wait behind the running one
+const size_t kMaxQueuedJobs = 4;
 
-std::pair<double, double>
-NativeAttractorCalc::clifford(double x, double y, double a, double b, double c, double d) {
-  return {std::sin(a * y) + c * std::cos(a * x), std::sin(b * x) + d * std::cos(b * y)};
+NativeAttractorCalc::NativeAttractorCalc(std::shared_ptr<CallInvoker> jsInvoker)
+    : NativeAttractorCalcCxxSpec(std::move(jsInvoker)) {
+  pool_ = std::make_unique<WorkerPool>(helperCount(), kMaxQueuedJobs);
+  core_ = std::make_unique<AttractorCore>(*pool_);
 }
 
-std::pair<double, double>
-NativeAttractorCalc::dejong(double x, double y, double a, double b, double c, double d) {
-  return {std::sin(a * y) - std::cos(b * x), std::sin(c * x) - std::cos(d * y)};
+size_t
+NativeAttractorCalc::helperCount() {
+  // The dispatcher thread takes part in parallelFor, so it gets one helper less than the cores
+  return std::max(1u, std::thread::hardware_concurrency()) - 1;
 }
 
-using AttractorFn =
-  std::function<std::pair<double, double>(double, double, double, double, double, double)>;
-
-AttractorFn
-NativeAttractorCalc::getAttractorFunction(std::string attractor) {
-  if (attractor == "clifford") {
-    return [=, this](double x, double y, double a, double b, double c, double d) {
-      return clifford(x, y, a, b, c, d);
-    };
-  } else if (attractor == "dejong") {
-    return [=, this](double x, double y, double a, double b, double c, double d) {
-      return dejong(x, y, a, b, c, d);
-    };
+NativeAttractorCalc::~NativeAttractorCalc() {
+  // Cancel every render first, so stopping the pool doesn't wait for a running job to
+  // finish its points, then stop the pool before the other members a job still uses
+  {
+    std::lock_guard<std::mutex> lock(cancelMutex_);
+    for (auto& [timestamp, weakToken] : cancelTokens_) {
+      if (auto token = weakToken.lock()) {
+        token->store(true);
+      }
+    }
   }
+  animationPool_.reset();
+  pool_.reset();
+}
 
-  // Error case - throw an exception for invalid attractor type
-  throw std::runtime_error(
-    "Invalid attractor type: " + attractor + ". Must be 'clifford' or 'dejong'."
-  );
+double
+NativeAttractorCalc::getQueueDepth(jsi::Runtime& rt) {
+  return static_cast<double>(pool_->queueDepth());
 }
 
+// Cancelled renders remembered, so chunks they still submit are rejected
+const size_t kMaxCancelledTimestamps = 16;
+
 void
-NativeAttractorCalc::accumulateDensity(AccumulationContext& context) {
-  int i = 0;
-  while (i < context.pointsToCalculate) {
-    auto next = context.fn(
-      context.x,
-      context.y,
-      context.attractorParams.a,
-      context.attractorParams.b,
-      context.attractorParams.c,
-      context.attractorParams.d
-    );
-    context.x = smoothing(next.first, context.attractorParams.scale);
-    context.y = smoothing(next.second, context.attractorParams.scale);
-
-    double screenX = context.x * context.attractorParams.scale;
-    double screenY = context.y * context.attractorParams.scale;
-    int px = static_cast<int>(std::floor(context.centerX + screenX));
-    int py = static_cast<int>(std::floor(context.centerY + screenY));
-
-    if (px >= 0 && px < context.w && py >= 0 && py < context.h) {
-      int idx = py * context.w + px;
-      if (idx >= 0 && idx < static_cast<int>(context.densitySize)) {
-        context.densityPtr[idx]++;
-        if (context.densityPtr[idx] > context.maxDensity) {
-          context.maxDensity = context.densityPtr[idx];
-        }
+NativeAttractorCalc::cancelCalculation(jsi::Runtime& rt, std::string timestamp) {
+  {
+    std::lock_guard<std::mutex> lock(cancelMutex_);
+    auto it = cancelTokens_.find(timestamp);
+    if (it != cancelTokens_.end()) {
+      if (auto token = it->second.lock()) {
+        token->store(true);
       }
+      cancelTokens_.erase(it);
     }
-
-    i++;
+    cancelledTimestamps_.push_back(timestamp);
+    if (cancelledTimestamps_.size() > kMaxCancelledTimestamps) {
+      cancelledTimestamps_.pop_front();
+    }
+  }
+  pool_->cancel(timestamp);
+  if (animationPool_) {
+    animationPool_->cancel(timestamp);
   }
 }
 
-void
-NativeAttractorCalc::createImageData(ImageDataCreationContext& context) {
-  int loopLimit = context.imageSize;
-
-  uint32_t bgColor = 0;
-  if (!context.attractorParams.background.empty()) {
-    uint32_t bgA =
-      context.attractorParams.background.size() > 3 ? context.attractorParams.background[3] : 255;
-    uint32_t bgB =
-      context.attractorParams.background.size() > 2 ? context.attractorParams.background[2] : 0;
-    uint32_t bgG =
-      context.attractorParams.background.size() > 1 ? context.attractorParams.background[1] : 0;
-    uint32_t bgR = context.attractorParams.background[0];
-    bgColor = (bgA << 24) | (bgB << 16) | (bgG << 8) | bgR;
-  }
-
-  int i = 0;
-  while (i < loopLimit) {
-    uint32_t dval = context.densityPtr[i];
-    if (dval > 0) {
-      if (context.highQuality) {
-        context.imageData[i] = getColorData(
-          dval,
-          context.maxDensity,
-          context.attractorParams.hue,
-          context.attractorParams.saturation,
-          context.attractorParams.brightness,
-          1.0,
-          context.attractorParams.background
-        );
-      } else {
-        context.imageData[i] = getLowQualityPoint(
-          context.attractorParams.hue,
-          context.attractorParams.saturation,
-          context.attractorParams.brightness
-        );
-      }
-    } else {
-      context.imageData[i] = bgColor;
-    }
-    i++;
+std::shared_ptr<std::atomic<bool>>
+NativeAttractorCalc::getCancelToken(const std::string& timestamp) {
+  std::lock_guard<std::mutex> lock(cancelMutex_);
+
+  // Forget the renders that have no job left
+  for (auto it = cancelTokens_.begin(); it != cancelTokens_.end();) {
+    it = it->second.expired() ? cancelTokens_.erase(it) : std::next(it);
   }
+
+  auto token = cancelTokens_[timestamp].lock();
+  if (!token) {
+    bool cancelled =
+      std::find(cancelledTimestamps_.begin(), cancelledTimestamps_.end(), timestamp) !=
+      cancelledTimestamps_.end();
+    token = std::make_shared<std::atomic<bool>>(cancelled);
+    cancelTokens_[timestamp] = token;
+  }
+  return token;
 }
 
-NativeAttractorCalc::NativeAttractorCalc(std::shared_ptr<CallInvoker> jsInvoker)
-    : NativeAttractorCalcCxxSpec(std::move(jsInvoker)) {
+// The map of the buffer, scanned from its density the first time a job sees the buffer.
+// A buffer JS reallocated at the same address keeps a map with too many tiles, which
+// only costs the work the map would have saved.
+OccupancyMap&
+NativeAttractorCalc::occupancyFor(const uint32_t* densityBufferPtr, int width, int height) {
+  if (!occupancy_ || occupancyBuffer_ != densityBufferPtr || occupancy_->width() != width ||
+      occupancy_->height() != height) {
+    occupancy_ = std::make_unique<OccupancyMap>(width, height);
+    occupancy_->scan(densityBufferPtr, DensityLayout::ROW_MAJOR);
+    occupancyBuffer_ = densityBufferPtr;
+  }
+  return *occupancy_;
 }
 
 void
-NativeAttractorCalc::startAttractorCalculationThread(
-  StartAttractorCalculationThreadParams& params
-) {
-  // Manually create a thread to run the calculation in the background
-  std::thread([this, params]() {
+NativeAttractorCalc::queueAttractorCalculation(QueueAttractorCalculationParams& params) {
+  std::shared_ptr<std::atomic<bool>> cancelToken = getCancelToken(params.timestamp);
+
+  // Jobs queued for an older or cancelled render are dropped, so their promises are rejected here
+  auto drop = [jsInvoker = jsInvoker_, rejectFunc = params.rejectFunc, cancelToken]() {
+    std::string reason =
+      cancelToken->load() ? "Calculation cancelled" : "Calculation superseded by a newer render";
+    jsInvoker->invokeAsync([rejectFunc, reason](jsi::Runtime& runtime) {
+      rejectFunc->call(runtime, jsi::String::createFromUtf8(runtime, reason));
+    });
+  };
+
+  auto run = [this, params, cancelToken, drop]() {
+    if (cancelToken->load()) {
+      drop();
+      return;
+    }
+
     try {
-      // get attractor function
-      auto attractorFunc = getAttractorFunction(params.attractorParams.attractor);
+      // get attractor type, the kernel is specialized on it
+      AttractorType attractorType =
+        AttractorCore::getAttractorType(params.attractorParams.attractor);
 
       // Initialize calculation variables - use the passed density buffer
       // directly Note: We're no longer clearing the density buffer to allow
       // accumulation across calls
       size_t densitySize = params.width * params.height;
 
-      double centerX = params.width / 2.0 + params.attractorParams.left;
-      double centerY = params.height / 2.0 + params.attractorParams.top;
+      double centerX = AttractorCore::centerX(params.attractorParams, params.width);
+      double centerY = AttractorCore::centerY(params.attractorParams, params.height);
+      OccupancyMap& occupancy =
+        occupancyFor(params.densityBufferPtr, params.width, params.height);
 
       // Create reference-able variables
       int maxDensityRef = params.maxDensity;
       double xRef = params.x;
       double yRef = params.y;
 
-      AccumulationContext context = {
-        .densityPtr = params.densityBufferPtr,
-        .densitySize = densitySize,
-        .maxDensity = maxDensityRef,
-        .x = xRef,
-        .y = yRef,
-        .pointsToCalculate = params.pointsToCalculate,
-        .w = params.width,
-        .h = params.height,
-        .attractorParams = params.attractorParams,
-        .centerX = centerX,
-        .centerY = centerY,
-        .fn = attractorFunc,
+      // Points the density held before this job: counted by the caller across the calls of
+      // a render, or none when it starts on an empty density. Without them there is no
+      // telling how thin the density is, and the frames aren't coarse.
+      int64_t pointsBefore = params.options.pointsBefore;
+      if (pointsBefore < 0 && params.maxDensity == 0) {
+        pointsBefore = 0;
+      }
+      bool coarsePreview = params.options.coarsePreview && pointsBefore >= 0;
+      if (coarsePreview &&
+          (pyramid_.width() != params.width || pyramid_.height() != params.height)) {
+        pyramid_ = DensityPyramid(params.width, params.height);
+      }
+      // Level of a frame once pointsDone points of this job are in the buffer
+      auto previewLevel = [&](int64_t pointsDone) {
+        return coarsePreview
+          ? DensityPyramid::previewLevel(pointsBefore + pointsDone, params.width, params.height)
+          : 0;
+      };
+
+      // Frames drawn from orbit 0's report run inside parallelFor and must not go parallel
+      auto drawFrame = [&](int maxDensity, int level, bool parallel) {
+        if (level > 0) {
+          maxDensity = static_cast<int>(pyramid_.build(params.densityBufferPtr, level, &occupancy));
+        }
+        ImageDataCreationContext frameContext = {
+          .imageData = params.imageBufferPtr,
+          .imageSize = params.width * params.height,
+          .densityPtr = params.densityBufferPtr,
+          .densitySize = densitySize,
+          .maxDensity = maxDensity,
+          .highQuality = params.highQuality,
+          .attractorParams = params.attractorParams,
+          .width = params.width,
+          .height = params.height,
+          .occupancy = &occupancy,
+          .pyramid = &pyramid_,
+          .pyramidLevel = level,
+          .parallel = parallel,
+        };
+        core_->createImageData(frameContext);
       };
-      accumulateDensity(context);
-
-      // Draw the current state on the buffer
-      ImageDataCreationContext imageContext = {
-        .imageData = reinterpret_cast<uint32_t*>(params.imageBufferPtr),
-        .imageSize = params.width * params.height,
-        .densityPtr = params.densityBufferPtr,
-        .densitySize = densitySize,
-        .maxDensity = maxDensityRef,
-        .highQuality = params.highQuality,
-        .attractorParams = params.attractorParams
+
+      auto sendProgress = [&](int64_t pointsDone, uint32_t maxDensity, bool frame) {
+        double progress = static_cast<double>(pointsDone) / std::max(1, params.pointsToCalculate);
+        this->jsInvoker_->invokeAsync([onProgress = params.options.onProgress,
+                                       timestamp = params.timestamp,
+                                       progress = std::min(1.0, progress),
+                                       pointsDone,
+                                       maxDensity,
+                                       frame](jsi::Runtime& runtime) {
+          jsi::Object event = jsi::Object(runtime);
+          event.setProperty(runtime, "timestamp", jsi::String::createFromUtf8(runtime, timestamp));
+          event.setProperty(runtime, "progress", jsi::Value(progress));
+          event.setProperty(runtime, "pointsAdded", jsi::Value(static_cast<double>(pointsDone)));
+          event.setProperty(runtime, "maxDensity", jsi::Value(static_cast<double>(maxDensity)));
+          event.setProperty(runtime, "frame", jsi::Value(frame));
+          onProgress->call(runtime, event);
+        });
       };
-      createImageData(imageContext);
+
+      // With a chunk budget the job reports whole frames between its chunks instead
+      bool scheduled = params.options.chunkBudgetMs > 0;
+      int64_t pointsDone = params.pointsToCalculate;
+      bool converged = false;
+      int orbits = 1;  // of the running accumulate
+
+      CalculationMonitor monitor;
+      monitor.cancelled = cancelToken;
+      if (params.options.onProgress && !scheduled) {
+        monitor.reportInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double, std::milli>(std::max(0.0, params.options.progressInterval))
+        );
+        monitor.nextReport = std::chrono::steady_clock::now() + monitor.reportInterval;
+        monitor.report = [&](int64_t pointsDone, uint32_t maxDensity) {
+          // Orbit 0 reports from its own thread, so its part of the density is stable here.
+          // The other orbits' points are still in their shards, the buffer only holds
+          // orbit 0's share of pointsDone.
+          bool frame = params.options.partialFrames && maxDensity > 0;
+          if (frame) {
+            drawFrame(static_cast<int>(maxDensity), previewLevel(pointsDone / orbits), false);
+          }
+          sendProgress(pointsDone, maxDensity, frame);
+        };
+      }
+
+      // The ring carries on across renders while the map, a-d and scale stay the same,
+      // points recorded before a pan are as good as new ones
+      OrbitRecorder* recorder = nullptr;
+      if (params.options.recordOrbit > 0) {
+        // Every thread of the pool may run an orbit that records
+        int orbits = pool_->concurrency();
+        size_t capacity =
+          OrbitRecorder::capacityFor(static_cast<size_t>(params.options.recordOrbit), orbits);
+        if (!orbitRecorder_ || !orbitRecorder_->matches(params.attractorParams) ||
+            orbitRecorder_->capacity() < capacity) {
+          orbitRecorder_ =
+            std::make_unique<OrbitRecorder>(capacity, orbits, params.attractorParams);
+        }
+        recorder = orbitRecorder_.get();
+      }
+
+      auto accumulate = [&](int points) {
+        AccumulationContext context = {
+          .densityPtr = params.densityBufferPtr,
+          .densitySize = densitySize,
+          .maxDensity = maxDensityRef,
+          .x = xRef,
+          .y = yRef,
+          .pointsToCalculate = points,
+          .w = params.width,
+          .h = params.height,
+          .attractorParams = params.attractorParams,
+          .centerX = centerX,
+          .centerY = centerY,
+          .attractorType = attractorType,
+          .monitor = &monitor,
+          .reportsProgress = true,
+          .occupancy = &occupancy,
+          .recorder = recorder,
+        };
+        int threadCount =
+          core_->resolveThreadCount(params.options.threadCount, points, densitySize);
+        orbits = threadCount;
+        core_->accumulateDensityParallel(context, threadCount, params.options.useSimd);
+      };
+
+      if (scheduled) {
+        // Chunks sized to the budget, with a full frame at the target frame rate
+        ChunkScheduler scheduler(params.options.chunkBudgetMs, params.options.targetFps);
+        ConvergenceTracker tracker(params.options.convergenceThreshold);
+        auto densityAt = [&](size_t i) { return params.densityBufferPtr[i]; };
+        auto jobStart = std::chrono::steady_clock::now();
+        auto elapsedMs = [&]() {
+          using Milliseconds = std::chrono::duration<double, std::milli>;
+          return Milliseconds(std::chrono::steady_clock::now() - jobStart).count();
+        };
+        int64_t done = 0;
+        while (done < params.pointsToCalculate && !cancelToken->load()) {
+          int chunk = scheduler.nextChunk(params.pointsToCalculate - done);
+          double chunkStart = elapsedMs();
+          accumulate(chunk);
+          scheduler.record(chunk, elapsedMs() - chunkStart);
+          done += chunk;
+
+          if (params.options.convergenceThreshold > 0 &&
+              tracker.update(densityAt, densitySize, maxDensityRef, done)) {
+            converged = true;
+            break;
+          }
+
+          // The last frame is drawn below, after the loop
+          if (params.options.onProgress && done < params.pointsToCalculate &&
+              scheduler.shouldDraw(elapsedMs())) {
+            drawFrame(maxDensityRef, previewLevel(done), true);
+            sendProgress(done, maxDensityRef, true);
+          }
+        }
+        pointsDone = done;
+      } else {
+        accumulate(params.pointsToCalculate);
+      }
+      if (cancelToken->load()) {
+        drop();
+        return;
+      }
+
+      // Draw the current state on the buffer, coarse too while more calls of the render
+      // follow
+      bool lastCall = converged || params.options.renderPoints <= pointsBefore + pointsDone;
+      drawFrame(maxDensityRef, lastCall ? 0 : previewLevel(pointsDone), true);
 
       // resolve the promise with the result
       this->jsInvoker_->invokeAsync([resolveFunc = params.resolveFunc,
@@ -417,14 +374,15 @@ NativeAttractorCalc::startAttractorCalculationThread(
                                      maxDensityRef,
                                      xRef,
                                      yRef,
-                                     pointsToCalculate =
-                                       params.pointsToCalculate](jsi::Runtime& runtime) {
+                                     pointsDone,
+                                     converged](jsi::Runtime& runtime) {
         jsi::Object result = jsi::Object(runtime);
         result.setProperty(runtime, "timestamp", jsi::String::createFromUtf8(runtime, timestamp));
         result.setProperty(runtime, "maxDensity", jsi::Value(maxDensityRef));
         result.setProperty(runtime, "x", jsi::Value(xRef));
         result.setProperty(runtime, "y", jsi::Value(yRef));
-        result.setProperty(runtime, "pointsAdded", jsi::Value(pointsToCalculate));
+        result.setProperty(runtime, "pointsAdded", jsi::Value(static_cast<double>(pointsDone)));
+        result.setProperty(runtime, "converged", jsi::Value(converged));
         resolveFunc->call(runtime, result);
       });
 
@@ -436,8 +394,65 @@ NativeAttractorCalc::startAttractorCalculationThread(
         rejectFunc->call(runtime, jsi::String::createFromUtf8(runtime, error_message));
       });
     }
-  }).detach();  // Detach the thread to allow the JS function to return
-                // immediately
+  };
+
+  pool_->submit({params.timestamp, run, drop});
+}
+
+// Helper method to convert the JSI options object, when one is passed, to CalculationOptions
+CalculationOptions
+NativeAttractorCalc::extractCalculationOptions(jsi::Runtime& rt, jsi::Object& jsiOptions) {
+  CalculationOptions options;
+  jsi::Value threadCount = jsiOptions.getProperty(rt, "threadCount");
+  if (threadCount.isNumber()) {
+    options.threadCount = static_cast<int>(threadCount.asNumber());
+  }
+  jsi::Value useSimd = jsiOptions.getProperty(rt, "useSimd");
+  if (useSimd.isBool()) {
+    options.useSimd = useSimd.getBool();
+  }
+  jsi::Value onProgress = jsiOptions.getProperty(rt, "onProgress");
+  if (onProgress.isObject() && onProgress.asObject(rt).isFunction(rt)) {
+    options.onProgress =
+      std::make_shared<jsi::Function>(onProgress.asObject(rt).asFunction(rt));
+  }
+  jsi::Value progressInterval = jsiOptions.getProperty(rt, "progressInterval");
+  if (progressInterval.isNumber()) {
+    options.progressInterval = progressInterval.asNumber();
+  }
+  jsi::Value chunkBudgetMs = jsiOptions.getProperty(rt, "chunkBudgetMs");
+  if (chunkBudgetMs.isNumber()) {
+    options.chunkBudgetMs = chunkBudgetMs.asNumber();
+  }
+  jsi::Value targetFps = jsiOptions.getProperty(rt, "targetFps");
+  if (targetFps.isNumber()) {
+    options.targetFps = targetFps.asNumber();
+  }
+  jsi::Value convergenceThreshold = jsiOptions.getProperty(rt, "convergenceThreshold");
+  if (convergenceThreshold.isNumber()) {
+    options.convergenceThreshold = convergenceThreshold.asNumber();
+  }
+  jsi::Value pointsBefore = jsiOptions.getProperty(rt, "pointsBefore");
+  if (pointsBefore.isNumber()) {
+    options.pointsBefore = static_cast<int64_t>(pointsBefore.asNumber());
+  }
+  jsi::Value renderPoints = jsiOptions.getProperty(rt, "renderPoints");
+  if (renderPoints.isNumber()) {
+    options.renderPoints = static_cast<int64_t>(renderPoints.asNumber());
+  }
+  jsi::Value recordOrbit = jsiOptions.getProperty(rt, "recordOrbit");
+  if (recordOrbit.isNumber()) {
+    options.recordOrbit = std::max(0, static_cast<int>(recordOrbit.asNumber()));
+  }
+  jsi::Value partialFrames = jsiOptions.getProperty(rt, "partialFrames");
+  if (partialFrames.isBool()) {
+    options.partialFrames = partialFrames.getBool();
+  }
+  jsi::Value coarsePreview = jsiOptions.getProperty(rt, "coarsePreview");
+  if (coarsePreview.isBool()) {
+    options.coarsePreview = coarsePreview.getBool();
+  }
+  return options;
 }
 
 // Helper method to convert JSI object to AttractorParameters
@@ -449,6 +464,25 @@ NativeAttractorCalc::extractAttractorParameters(jsi::Runtime& rt, jsi::Object& j
     background.push_back(static_cast<int>(backgroundArray.getValueAtIndex(rt, i).asNumber()));
   }
 
+  // Optional, JS numbers hold integer seeds up to 2^53 exactly
+  std::optional<uint64_t> seed;
+  jsi::Value jsSeed = jsiParams.getProperty(rt, "seed");
+  if (jsSeed.isNumber()) {
+    seed = static_cast<uint64_t>(static_cast<int64_t>(jsSeed.asNumber()));
+  }
+
+  // Optional, "exact" unless set
+  TrigPrecision precision = TrigPrecision::EXACT;
+  jsi::Value jsPrecision = jsiParams.getProperty(rt, "precision");
+  if (jsPrecision.isString()) {
+    std::string name = jsPrecision.asString(rt).utf8(rt);
+    std::optional<TrigPrecision> parsed = parseTrigPrecision(name);
+    if (!parsed) {
+      throw jsi::JSError(rt, "Invalid precision: " + name + ". Must be exact, float or fast.");
+    }
+    precision = *parsed;
+  }
+
   return {
     std::string(jsiParams.getProperty(rt, "attractor").asString(rt).utf8(rt)),
     jsiParams.getProperty(rt, "a").asNumber(),
@@ -461,7 +495,9 @@ NativeAttractorCalc::extractAttractorParameters(jsi::Runtime& rt, jsi::Object& j
     background,
     jsiParams.getProperty(rt, "scale").asNumber(),
     jsiParams.getProperty(rt, "left").asNumber(),
-    jsiParams.getProperty(rt, "top").asNumber()
+    jsiParams.getProperty(rt, "top").asNumber(),
+    seed,
+    precision
   };
 }
 
@@ -480,10 +516,13 @@ NativeAttractorCalc::calculateAttractor(
   double y,
   int maxDensity,
 
-  int pointsToCalculate
+  int pointsToCalculate,
+  std::optional<jsi::Object> options
 ) {
   // Extract parameters from JSI object
   AttractorParameters attractorParams = extractAttractorParameters(rt, attractorParameters);
+  CalculationOptions calculationOptions =
+    options ? extractCalculationOptions(rt, *options) : CalculationOptions{};
 
   // 1. Validate and get the ArrayBuffer
   if (!densityBuffer.isArrayBuffer(rt)) {
@@ -519,7 +558,8 @@ NativeAttractorCalc::calculateAttractor(
        y,
        maxDensity,
        highQuality,
-       pointsToCalculate](
+       pointsToCalculate,
+       calculationOptions](
         jsi::Runtime& runtime, const jsi::Value&, const jsi::Value* args, size_t count
       ) -> jsi::Value {
         auto resolveFunc =
@@ -527,8 +567,8 @@ NativeAttractorCalc::calculateAttractor(
         auto rejectFunc =
           std::make_shared<jsi::Function>(args[1].asObject(runtime).asFunction(runtime));
 
-        // Create the thread parameters
-        StartAttractorCalculationThreadParams threadParams = {
+        // Create the job parameters
+        QueueAttractorCalculationParams jobParams = {
           timestamp,
           densityBufferPtr,
           imageBufferPtr,
@@ -540,12 +580,13 @@ NativeAttractorCalc::calculateAttractor(
           y,
           maxDensity,
           pointsToCalculate,
+          calculationOptions,
           resolveFunc,
           rejectFunc
         };
 
-        // Start the attractor calculation in a separate thread
-        startAttractorCalculationThread(threadParams);
+        // Queue the attractor calculation on the worker pool
+        queueAttractorCalculation(jobParams);
         return jsi::Value::undefined();
       }
     )
@@ -555,4 +596,296 @@ NativeAttractorCalc::calculateAttractor(
   return promise;
 }
 
+jsi::Value
+NativeAttractorCalc::renderAnimation(
+  jsi::Runtime& rt,
+  std::string timestamp,
+  jsi::Array keyframes,
+  int frameCount,
+  int width,
+  int height,
+  int pointsPerFrame,
+  bool highQuality,
+  std::string outputPath,
+  std::optional<jsi::Object> options
+) {
+  AnimationOptions animation = {
+    .frameCount = std::max(0, frameCount),
+    .width = width,
+    .height = height,
+    .pointsPerFrame = pointsPerFrame,
+    .highQuality = highQuality,
+  };
+  for (size_t i = 0; i < keyframes.size(rt); i++) {
+    jsi::Object keyframe = keyframes.getValueAtIndex(rt, i).asObject(rt);
+    jsi::Object jsParams = keyframe.getProperty(rt, "attractorParameters").asObject(rt);
+    animation.keyframes.push_back({
+      .frame = static_cast<int>(keyframe.getProperty(rt, "frame").asNumber()),
+      .params = extractAttractorParameters(rt, jsParams),
+    });
+  }
+  if (animation.keyframes.empty()) {
+    throw jsi::JSError(rt, "renderAnimation needs at least one keyframe.");
+  }
+  if (width <= 0 || height <= 0 || pointsPerFrame <= 0) {
+    throw jsi::JSError(rt, "width, height and pointsPerFrame must be positive.");
+  }
+  if (static_cast<int64_t>(width) * height > std::numeric_limits<int>::max()) {
+    throw jsi::JSError(rt, "width x height must be at most 2147483647 pixels.");
+  }
+  CalculationOptions calculationOptions =
+    options ? extractCalculationOptions(rt, *options) : CalculationOptions{};
+  animation.useSimd = calculationOptions.useSimd;
+  if (!animationPool_) {
+    animationPool_ = std::make_unique<WorkerPool>(helperCount(), kMaxQueuedJobs);
+    animationCore_ = std::make_unique<AttractorCore>(*animationPool_);
+  }
+  std::shared_ptr<jsi::Function> onFrame;
+  jsi::Value jsOnFrame = options ? options->getProperty(rt, "onFrame") : jsi::Value::undefined();
+  if (jsOnFrame.isObject() && jsOnFrame.asObject(rt).isFunction(rt)) {
+    onFrame = std::make_shared<jsi::Function>(jsOnFrame.asObject(rt).asFunction(rt));
+  }
+
+  auto promiseCtor = rt.global().getPropertyAsFunction(rt, "Promise");
+  return promiseCtor.callAsConstructor(
+    rt,
+    jsi::Function::createFromHostFunction(
+      rt,
+      jsi::PropNameID::forAscii(rt, "executor"),
+      2,  // resolve and reject
+      [this, timestamp, animation, outputPath, onFrame](
+        jsi::Runtime& runtime, const jsi::Value&, const jsi::Value* args, size_t count
+      ) -> jsi::Value {
+        auto resolveFunc =
+          std::make_shared<jsi::Function>(args[0].asObject(runtime).asFunction(runtime));
+        auto rejectFunc =
+          std::make_shared<jsi::Function>(args[1].asObject(runtime).asFunction(runtime));
+        std::shared_ptr<std::atomic<bool>> cancelToken = getCancelToken(timestamp);
+
+        auto reject = [jsInvoker = jsInvoker_, rejectFunc](std::string reason) {
+          jsInvoker->invokeAsync([rejectFunc, reason](jsi::Runtime& runtime) {
+            rejectFunc->call(runtime, jsi::String::createFromUtf8(runtime, reason));
+          });
+        };
+        auto drop = [reject, cancelToken]() {
+          reject(
+            cancelToken->load() ? "Animation cancelled" : "Animation superseded by a newer render"
+          );
+        };
+
+        // One job for the whole animation on the animation pool, its frames fan out over
+        // that pool while the app's renders keep running on their own
+        auto run = [this,
+                    timestamp,
+                    animation,
+                    outputPath,
+                    onFrame,
+                    resolveFunc,
+                    reject,
+                    drop,
+                    cancelToken]() {
+          if (cancelToken->load()) {
+            drop();
+            return;
+          }
+          try {
+            using FilePtr = std::unique_ptr<FILE, int (*)(FILE*)>;
+            FilePtr output(std::fopen(outputPath.c_str(), "wb"), &std::fclose);
+            if (!output) {
+              throw std::runtime_error("Cannot open " + outputPath);
+            }
+            size_t pixels = static_cast<size_t>(animation.width) * animation.height;
+            int framesDone = 0;
+            bool complete = facebook::react::renderAnimation(
+              *animationCore_,
+              *animationPool_,
+              animation,
+              [&](int frame, const uint32_t* image) {
+                if (std::fwrite(image, sizeof(uint32_t), pixels, output.get()) != pixels) {
+                  throw std::runtime_error("Failed to write frame " + std::to_string(frame));
+                }
+                framesDone++;
+                if (onFrame) {
+                  this->jsInvoker_->invokeAsync([onFrame, timestamp, frame, framesDone](
+                                                  jsi::Runtime& runtime
+                                                ) {
+                    jsi::Object event = jsi::Object(runtime);
+                    event.setProperty(
+                      runtime, "timestamp", jsi::String::createFromUtf8(runtime, timestamp)
+                    );
+                    event.setProperty(runtime, "frame", jsi::Value(frame));
+                    event.setProperty(runtime, "framesDone", jsi::Value(framesDone));
+                    onFrame->call(runtime, event);
+                  });
+                }
+              },
+              cancelToken
+            );
+            if (std::fclose(output.release()) != 0) {
+              throw std::runtime_error("Failed to write " + outputPath);
+            }
+            if (!complete) {
+              drop();
+              return;
+            }
+
+            this->jsInvoker_->invokeAsync([resolveFunc, timestamp, framesDone](
+                                            jsi::Runtime& runtime
+                                          ) {
+              jsi::Object result = jsi::Object(runtime);
+              result.setProperty(
+                runtime, "timestamp", jsi::String::createFromUtf8(runtime, timestamp)
+              );
+              result.setProperty(runtime, "frames", jsi::Value(framesDone));
+              resolveFunc->call(runtime, result);
+            });
+          } catch (const std::exception& e) {
+            reject(e.what());
+          }
+        };
+
+        animationPool_->submit({timestamp, run, drop});
+        return jsi::Value::undefined();
+      }
+    )
+  );
+}
+
+jsi::Value
+NativeAttractorCalc::rebinAttractor(
+  jsi::Runtime& rt,
+  std::string timestamp,
+  jsi::Object densityBuffer,
+  jsi::Object imageBuffer,
+  bool highQuality,
+
+  jsi::Object attractorParameters,
+  int width,
+  int height
+) {
+  AttractorParameters attractorParams = extractAttractorParameters(rt, attractorParameters);
+
+  if (!densityBuffer.isArrayBuffer(rt)) {
+    throw jsi::JSError(rt, "Second argument must be an ArrayBuffer.");
+  }
+  if (!imageBuffer.isArrayBuffer(rt)) {
+    throw jsi::JSError(rt, "Third argument must be an ArrayBuffer.");
+  }
+  auto densityArrayBuffer = densityBuffer.getArrayBuffer(rt);
+  auto imageArrayBuffer = imageBuffer.getArrayBuffer(rt);
+  size_t pixels = static_cast<size_t>(std::max(0, width)) * std::max(0, height);
+  if (densityArrayBuffer.size(rt) < pixels * sizeof(uint32_t) ||
+      imageArrayBuffer.size(rt) < pixels * sizeof(uint32_t)) {
+    throw jsi::JSError(rt, "Buffers are smaller than width * height * 4 bytes.");
+  }
+  uint32_t* densityBufferPtr = reinterpret_cast<uint32_t*>(densityArrayBuffer.data(rt));
+  uint32_t* imageBufferPtr = reinterpret_cast<uint32_t*>(imageArrayBuffer.data(rt));
+  // Set by cancelCalculation(timestamp), like the calculations' token
+  std::shared_ptr<std::atomic<bool>> cancelToken = getCancelToken(timestamp);
+
+  auto promiseCtor = rt.global().getPropertyAsFunction(rt, "Promise");
+  return promiseCtor.callAsConstructor(
+    rt,
+    jsi::Function::createFromHostFunction(
+      rt,
+      jsi::PropNameID::forAscii(rt, "executor"),
+      2,  // resolve and reject
+      [this,
+       timestamp,
+       cancelToken,
+       densityBufferPtr,
+       imageBufferPtr,
+       highQuality,
+       attractorParams,
+       width,
+       height](jsi::Runtime& runtime, const jsi::Value&, const jsi::Value* args, size_t count)
+        -> jsi::Value {
+        auto resolveFunc =
+          std::make_shared<jsi::Function>(args[0].asObject(runtime).asFunction(runtime));
+        auto rejectFunc =
+          std::make_shared<jsi::Function>(args[1].asObject(runtime).asFunction(runtime));
+
+        auto drop = [jsInvoker = jsInvoker_, rejectFunc, cancelToken]() {
+          std::string reason =
+            cancelToken->load() ? "Rebin cancelled" : "Rebin superseded by a newer render";
+          jsInvoker->invokeAsync([rejectFunc, reason](jsi::Runtime& runtime) {
+            rejectFunc->call(runtime, jsi::String::createFromUtf8(runtime, reason));
+          });
+        };
+
+        // A job like the calculations, so it waits for a recording job to finish
+        auto run = [this,
+                    timestamp,
+                    densityBufferPtr,
+                    imageBufferPtr,
+                    highQuality,
+                    attractorParams,
+                    width,
+                    height,
+                    resolveFunc,
+                    cancelToken,
+                    drop]() {
+          if (cancelToken->load()) {
+            drop();
+            return;
+          }
+          if (!orbitRecorder_ || !orbitRecorder_->matches(attractorParams)) {
+            this->jsInvoker_->invokeAsync([resolveFunc](jsi::Runtime& runtime) {
+              resolveFunc->call(runtime, jsi::Value::null());
+            });
+            return;
+          }
+
+          size_t densitySize = static_cast<size_t>(width) * height;
+          OccupancyMap& occupancy = occupancyFor(densityBufferPtr, width, height);
+          occupancy.clearDensity(densityBufferPtr, DensityLayout::ROW_MAJOR);
+          int64_t pointsAdded = 0;
+          uint32_t maxDensity = orbitRecorder_->rebin(
+            densityBufferPtr,
+            nullptr,
+            &occupancy,
+            DensityLayout::ROW_MAJOR,
+            width,
+            height,
+            AttractorCore::centerX(attractorParams, width),
+            AttractorCore::centerY(attractorParams, height),
+            pointsAdded,
+            pool_.get()
+          );
+
+          ImageDataCreationContext imageContext = {
+            .imageData = imageBufferPtr,
+            .imageSize = width * height,
+            .densityPtr = densityBufferPtr,
+            .densitySize = densitySize,
+            .maxDensity = static_cast<int>(maxDensity),
+            .highQuality = highQuality,
+            .attractorParams = attractorParams,
+            .occupancy = &occupancy,
+            .parallel = true,
+          };
+          core_->createImageData(imageContext);
+
+          this->jsInvoker_->invokeAsync([resolveFunc, timestamp, maxDensity, pointsAdded](
+                                          jsi::Runtime& runtime
+                                        ) {
+            jsi::Object result = jsi::Object(runtime);
+            result.setProperty(
+              runtime, "timestamp", jsi::String::createFromUtf8(runtime, timestamp)
+            );
+            result.setProperty(runtime, "maxDensity", jsi::Value(static_cast<double>(maxDensity)));
+            result.setProperty(
+              runtime, "pointsAdded", jsi::Value(static_cast<double>(pointsAdded))
+            );
+            resolveFunc->call(runtime, result);
+          });
+        };
+
+        pool_->submit({timestamp, run, drop});
+        return jsi::Value::undefined();
+      }
+    )
+  );
+}
+
 }  // namespace facebook::react
\ No newline at end of file
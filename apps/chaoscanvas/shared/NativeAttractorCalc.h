@@ -1,11 +1,23 @@
 #pragma once
 
 #include <NativeAttractorCalcSpecsJSI.h>
+#include "AnimationRenderer.h"
+#include "AttractorCore.h"
+#include "DensityPyramid.h"
+#include "OccupancyMap.h"
+#include "OrbitRecorder.h"
+#include "WorkerPool.h"
 #include <jsi/jsi.h>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <deque>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -20,58 +32,48 @@ enum PerformanceRating {
   UNKNOWN = 0
 };
 
-// Represents an RGB color
-struct RGB {
-  int r, g, b;
-};
-
-struct AttractorParameters {
-  std::string attractor;
-  double a;
-  double b;
-  double c;
-  double d;
-  double hue;
-  double saturation;
-  double brightness;
-  std::vector<int> background;
-  double scale;
-  double left;
-  double top;
-};
-
-struct AccumulationContext {
-  uint32_t* densityPtr;
-  size_t densitySize;
-  int& maxDensity;
-  double& x;
-  double& y;
-  const int pointsToCalculate;
-  const int w;
-  const int h;
-  const AttractorParameters& attractorParams;
-  const double centerX;
-  const double centerY;
-  const std::function<std::pair<double, double>(double, double, double, double, double, double)>&
-    fn;
-};
-
-struct ImageDataCreationContext {
-  uint32_t* imageData;
-  int imageSize;
-  const uint32_t* densityPtr;
-  size_t densitySize;
-  int maxDensity;
-  bool highQuality;
-  const AttractorParameters& attractorParams;
+// Optional settings passed in the last argument of calculateAttractor
+struct CalculationOptions {
+  int threadCount = 0;  // 0 uses every thread of the worker pool
+  bool useSimd = true;  // multi-orbit SIMD kernel when the CPU has one
+  // Called with { timestamp, progress, pointsAdded, maxDensity, frame } while the job runs
+  std::shared_ptr<jsi::Function> onProgress;
+  double progressInterval = 100;  // ms between two onProgress calls
+  bool partialFrames = false;     // redraw the image buffer before each onProgress call
+  // Frames are coloured from a 1/2 to 1/8 size copy of the density until it holds about
+  // a point per pixel (see DensityPyramid). Needs pointsBefore, or a job that starts on
+  // an empty density.
+  bool coarsePreview = true;
+  // Points the density held before this job, over the earlier calls of the render. -1
+  // when the caller doesn't count them.
+  int64_t pointsBefore = -1;
+  // Points of the whole render, so the frame at the end of a call that isn't the last
+  // one is coarse too. 0 makes every call's last frame full resolution.
+  int64_t renderPoints = 0;
+  // Runs the job in chunks sized to this many ms instead of in one go, and sends a whole
+  // frame to onProgress at targetFps between them. 0 turns it off.
+  double chunkBudgetMs = 0;
+  double targetFps = 30;
+  // With chunkBudgetMs, ends the job early once doubling its points changes the image by
+  // less than this (see ConvergenceTracker). 0 turns it off.
+  double convergenceThreshold = 0;
+  // Keeps the newest recordOrbit points of the orbit (4 bytes each), so rebinAttractor
+  // can redraw them for another left/top or canvas size. 0 turns it off, other values
+  // are raised to 16384 points per core.
+  int recordOrbit = 0;
 };
 
 class NativeAttractorCalc : public NativeAttractorCalcCxxSpec<NativeAttractorCalc> {
  public:
   NativeAttractorCalc(std::shared_ptr<CallInvoker> jsInvoker);
+  ~NativeAttractorCalc();
 
   double ratePerformance(jsi::Runtime& rt);
   std::string getBuildNumber(jsi::Runtime& rt);
+  // Calculation jobs waiting behind the running one
+  double getQueueDepth(jsi::Runtime& rt);
+  // Stops the running and queued jobs of a render, their promises reject
+  void cancelCalculation(jsi::Runtime& rt, std::string timestamp);
 
   jsi::Value calculateAttractor(
     jsi::Runtime& rt,
@@ -88,33 +90,52 @@ class NativeAttractorCalc : public NativeAttractorCalcCxxSpec<NativeAttractorCal
     double y,
     int maxDensity,
 
-    int pointsToCalculate
+    int pointsToCalculate,
+    std::optional<jsi::Object> options
   );
 
- private:
-  std::function<double(double)> bezierEasing(double p0, double p1, double p2, double p3);
-  RGB hsvToRgb(double h, double s, double v);
-  uint32_t getColorData(
-    double density,
-    double maxDensity,
-    double h,
-    double s,
-    double v,
-    double progress = 1.0,
-    const std::vector<int>& background = {0, 0, 0, 255}
+  // Redraws the points recorded with recordOrbit for a new left/top or canvas size,
+  // without iterating the map. Resolves with null when nothing was recorded for the
+  // map, a-d and scale of attractorParameters.
+  jsi::Value rebinAttractor(
+    jsi::Runtime& rt,
+
+    std::string timestamp,
+    jsi::Object densityBuffer,
+    jsi::Object imageBuffer,
+    bool highQuality,
+
+    jsi::Object attractorParameters,
+    int width,
+    int height
   );
-  uint32_t getLowQualityPoint(double hue, double saturation, double brightness);
-  double smoothing(double num, double scale);
-  std::pair<double, double> clifford(double x, double y, double a, double b, double c, double d);
-  std::pair<double, double> dejong(double x, double y, double a, double b, double c, double d);
-  std::function<std::pair<double, double>(double, double, double, double, double, double)>
-  getAttractorFunction(std::string attractor);
-  void accumulateDensity(AccumulationContext& context);
-  void createImageData(ImageDataCreationContext& context);
+
+  // Renders frameCount frames, a-d and the other numbers interpolated between the
+  // keyframes ({ frame, attractorParameters }), a frame per thread, and writes them
+  // to outputPath as raw RGBA frames back to back. options.onFrame is called with
+  // { timestamp, frame, framesDone } as each one is written. Runs on a pool of its own,
+  // so calculations don't queue behind it; cancelCalculation(timestamp) stops it and
+  // rejects the promise.
+  jsi::Value renderAnimation(
+    jsi::Runtime& rt,
+
+    std::string timestamp,
+    jsi::Array keyframes,
+    int frameCount,
+    int width,
+    int height,
+    int pointsPerFrame,
+    bool highQuality,
+    std::string outputPath,
+    std::optional<jsi::Object> options
+  );
+
+ private:
   // Helper method to convert JSI object to AttractorParameters
   AttractorParameters extractAttractorParameters(jsi::Runtime& rt, jsi::Object& jsiParams);
+  CalculationOptions extractCalculationOptions(jsi::Runtime& rt, jsi::Object& jsiOptions);
 
-  struct StartAttractorCalculationThreadParams {
+  struct QueueAttractorCalculationParams {
     std::string timestamp;
 
     uint32_t* densityBufferPtr;
@@ -131,12 +152,41 @@ class NativeAttractorCalc : public NativeAttractorCalcCxxSpec<NativeAttractorCal
     int maxDensity;
 
     int pointsToCalculate;
+    CalculationOptions options;
 
     std::shared_ptr<jsi::Function> resolveFunc;
     std::shared_ptr<jsi::Function> rejectFunc;
   };
 
-  void startAttractorCalculationThread(StartAttractorCalculationThreadParams& params);
+  void queueAttractorCalculation(QueueAttractorCalculationParams& params);
+  std::shared_ptr<std::atomic<bool>> getCancelToken(const std::string& timestamp);
+  // Helper threads of each pool
+  static size_t helperCount();
+  OccupancyMap& occupancyFor(const uint32_t* densityBufferPtr, int width, int height);
+
+  // Cancel flag of each render with a job in flight, and the last cancelled renders,
+  // so a chunk submitted after the cancel is rejected straight away
+  std::unordered_map<std::string, std::weak_ptr<std::atomic<bool>>> cancelTokens_;
+  std::deque<std::string> cancelledTimestamps_;
+  std::mutex cancelMutex_;
+
+  // Runs calculation jobs, created with the module and stopped when it is destroyed
+  std::unique_ptr<WorkerPool> pool_;
+  // Iteration and colouring, runs its parallel work on pool_
+  std::unique_ptr<AttractorCore> core_;
+  // Runs animations, created by the first one. A pool of their own, so the app's renders
+  // don't wait behind the last frame of an animation.
+  std::unique_ptr<WorkerPool> animationPool_;
+  std::unique_ptr<AttractorCore> animationCore_;
+  // Orbit of the last render that recorded one. Only jobs touch it, and they run one
+  // at a time, so a re-bin never overlaps the recording.
+  std::unique_ptr<OrbitRecorder> orbitRecorder_;
+  // Occupied tiles of the density buffer the last job wrote, so the renders and re-bins
+  // that follow on it colour and clear only those. Only touched by jobs, like the orbit.
+  std::unique_ptr<OccupancyMap> occupancy_;
+  const uint32_t* occupancyBuffer_ = nullptr;
+  // Coarse levels of the density for the first frames of a render, only touched by jobs
+  DensityPyramid pyramid_;
 };
 
 }  // namespace facebook::react
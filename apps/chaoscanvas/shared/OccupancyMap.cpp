@@ -0,0 +1,87 @@
+#include "OccupancyMap.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace facebook::react {
+
+OccupancyMap::OccupancyMap(int width, int height)
+    : width_(std::max(0, width)),
+      height_(std::max(0, height)),
+      tilesPerRow_(densityTileCount(width_)),
+      tileRows_(densityTileCount(height_)),
+      wordCount_((static_cast<size_t>(tilesPerRow_) * tileRows_ + 63) >> 6),
+      words_(std::make_unique<std::atomic<uint64_t>[]>(wordCount_)) {}
+
+size_t
+OccupancyMap::occupiedTiles() const {
+  size_t count = 0;
+  for (size_t i = 0; i < wordCount_; i++) {
+    count += std::popcount(words_[i].load(std::memory_order_relaxed));
+  }
+  return count;
+}
+
+void
+OccupancyMap::clear() {
+  for (size_t i = 0; i < wordCount_; i++) {
+    words_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+void
+OccupancyMap::scan(const uint32_t* density, DensityLayout layout) {
+  for (int tileY = 0; tileY < tileRows_; tileY++) {
+    for (int tileX = 0; tileX < tilesPerRow_; tileX++) {
+      if (layout == DensityLayout::TILED) {
+        const uint32_t* tile =
+          density + (static_cast<size_t>(tileY) * tilesPerRow_ + tileX) * kDensityTileArea;
+        if (std::any_of(tile, tile + kDensityTileArea, [](uint32_t value) { return value; })) {
+          mark(tileX << kDensityTileShift, tileY << kDensityTileShift);
+        }
+        continue;
+      }
+      int x0 = tileX << kDensityTileShift;
+      int y0 = tileY << kDensityTileShift;
+      int columns = std::min(kDensityTileSize, width_ - x0);
+      int rows = std::min(kDensityTileSize, height_ - y0);
+      for (int row = 0; row < rows; row++) {
+        const uint32_t* span = density + static_cast<size_t>(y0 + row) * width_ + x0;
+        if (std::any_of(span, span + columns, [](uint32_t value) { return value; })) {
+          mark(x0, y0);
+          break;
+        }
+      }
+    }
+  }
+}
+
+void
+OccupancyMap::clearDensity(uint32_t* density, DensityLayout layout) {
+  for (int tileY = 0; tileY < tileRows_; tileY++) {
+    if (layout == DensityLayout::TILED) {
+      for (int tileX = 0; tileX < tilesPerRow_; tileX++) {
+        if (occupied(tileX, tileY)) {
+          size_t tile = (static_cast<size_t>(tileY) * tilesPerRow_ + tileX) * kDensityTileArea;
+          std::fill_n(density + tile, kDensityTileArea, 0);
+        }
+      }
+      continue;
+    }
+    int y0 = tileY << kDensityTileShift;
+    int rows = std::min(kDensityTileSize, height_ - y0);
+    forEachRun(tileY, [&](int tileX, int endTileX, bool marked) {
+      if (!marked) {
+        return;
+      }
+      int x0 = tileX << kDensityTileShift;
+      int columns = std::min(endTileX << kDensityTileShift, width_) - x0;
+      for (int row = 0; row < rows; row++) {
+        std::fill_n(density + static_cast<size_t>(y0 + row) * width_ + x0, columns, 0);
+      }
+    });
+  }
+  clear();
+}
+
+}  // namespace facebook::react
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "DensityLayout.h"
+
+namespace facebook::react {
+
+// One bit per 64x64 tile of the canvas, the tiles of the TILED layout, set by the
+// density sinks the first time a point lands in the tile.
+//
+// Most parameter sets put their points on a small part of the canvas. Colouring fills
+// the clear tiles with the background without reading their density, and clearing the
+// density only zeroes the marked ones. The bits may be stale the other way: a marked
+// tile with no points costs the work the map would have saved, nothing else.
+class OccupancyMap {
+ public:
+  OccupancyMap() = default;
+  OccupancyMap(int width, int height);
+
+  int
+  width() const {
+    return width_;
+  }
+
+  int
+  height() const {
+    return height_;
+  }
+
+  int
+  tilesPerRow() const {
+    return tilesPerRow_;
+  }
+
+  int
+  tileRows() const {
+    return tileRows_;
+  }
+
+  // Safe from several threads at once
+  void
+  mark(int x, int y) {
+    size_t tile =
+      static_cast<size_t>(y >> kDensityTileShift) * tilesPerRow_ + (x >> kDensityTileShift);
+    std::atomic<uint64_t>& word = words_[tile >> 6];
+    uint64_t bit = uint64_t(1) << (tile & 63);
+    // Load first, so the threads plotting into a tile keep sharing its cache line
+    if (!(word.load(std::memory_order_relaxed) & bit)) {
+      word.fetch_or(bit, std::memory_order_relaxed);
+    }
+  }
+
+  bool
+  occupied(int tileX, int tileY) const {
+    size_t tile = static_cast<size_t>(tileY) * tilesPerRow_ + tileX;
+    return (words_[tile >> 6].load(std::memory_order_relaxed) >> (tile & 63)) & 1;
+  }
+
+  // Calls fn(tileX, endTileX, occupied) for each run of tiles of tile row tileY that
+  // are all marked or all clear
+  template <typename Fn>
+  void
+  forEachRun(int tileY, Fn&& fn) const {
+    for (int tileX = 0; tileX < tilesPerRow_;) {
+      bool marked = occupied(tileX, tileY);
+      int end = tileX + 1;
+      while (end < tilesPerRow_ && occupied(end, tileY) == marked) {
+        end++;
+      }
+      fn(tileX, end, marked);
+      tileX = end;
+    }
+  }
+
+  size_t occupiedTiles() const;
+  void clear();
+
+  // Marks the tiles of a w x h density that hold a point, for a buffer the sinks
+  // didn't fill with this map
+  void scan(const uint32_t* density, DensityLayout layout);
+
+  // Zeroes the density of the marked tiles and clears the map. The density of the
+  // clear tiles has to be 0 already.
+  void clearDensity(uint32_t* density, DensityLayout layout);
+
+ private:
+  int width_ = 0;
+  int height_ = 0;
+  int tilesPerRow_ = 0;
+  int tileRows_ = 0;
+  size_t wordCount_ = 0;
+  std::unique_ptr<std::atomic<uint64_t>[]> words_;
+};
+
+}  // namespace facebook::react
@@ -0,0 +1,141 @@
+#include "OrbitRecorder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace facebook::react {
+
+OrbitCursor::~OrbitCursor() {
+  std::fill(next, end, OrbitRecorder::kEmpty);
+}
+
+size_t
+OrbitRecorder::capacityFor(size_t capacity, int orbits) {
+  size_t minBlocks = kMinBlocksPerOrbit * static_cast<size_t>(std::max(1, orbits));
+  return std::max(minBlocks, (capacity + kBlockSize - 1) / kBlockSize) * kBlockSize;
+}
+
+OrbitRecorder::OrbitRecorder(size_t capacity, int orbits, const AttractorParameters& params)
+    : params_(params), capacity_(capacityFor(capacity, orbits)), points_(new uint32_t[capacity_]) {
+  // |sin| and |cos| are at most 1, so the maps stay inside these bounds. The margin of a
+  // pixel covers the smoothing offset, which is less than one.
+  bool dejong = AttractorCore::getAttractorType(params.attractor) == AttractorType::DEJONG;
+  double margin = 1.0 / params.scale;
+  double boundX = (dejong ? 2.0 : 1.0 + std::abs(params.c)) + margin;
+  double boundY = (dejong ? 2.0 : 1.0 + std::abs(params.d)) + margin;
+  minX_ = -boundX;
+  minY_ = -boundY;
+  levelsPerUnitX_ = kMaxLevel / (2 * boundX);
+  levelsPerUnitY_ = kMaxLevel / (2 * boundY);
+  clear();
+}
+
+bool
+OrbitRecorder::matches(const AttractorParameters& params) const {
+  return params.attractor == params_.attractor && params.a == params_.a &&
+    params.b == params_.b && params.c == params_.c && params.d == params_.d &&
+    params.scale == params_.scale && params.precision == params_.precision;
+}
+
+size_t
+OrbitRecorder::size() const {
+  return static_cast<size_t>(std::min<uint64_t>(written_.load(), capacity_));
+}
+
+size_t
+OrbitRecorder::capacity() const {
+  return capacity_;
+}
+
+size_t
+OrbitRecorder::bytes() const {
+  return capacity_ * sizeof(uint32_t);
+}
+
+void
+OrbitRecorder::clear() {
+  std::fill(points_.get(), points_.get() + capacity_, kEmpty);
+  written_.store(0);
+}
+
+void
+OrbitRecorder::reserve(OrbitCursor& cursor) {
+  // The capacity is whole blocks, so a block never wraps around the end of the ring
+  size_t start = static_cast<size_t>(
+    written_.fetch_add(kBlockSize, std::memory_order_relaxed) % capacity_
+  );
+  cursor.next = points_.get() + start;
+  cursor.end = cursor.next + kBlockSize;
+}
+
+uint32_t
+OrbitRecorder::rebin(
+  uint32_t* densityPtr,
+  CompactDensity* compact,
+  OccupancyMap* occupancy,
+  DensityLayout layout,
+  int w,
+  int h,
+  double centerX,
+  double centerY,
+  int64_t& pointsPlotted,
+  WorkerPool* pool
+) const {
+  // Screen position of level 0 and the pixels per level, the same center + x * scale as
+  // the kernels
+  const double originX = centerX + minX_ * params_.scale;
+  const double originY = centerY + minY_ * params_.scale;
+  const double pixelsPerLevelX = params_.scale / levelsPerUnitX_;
+  const double pixelsPerLevelY = params_.scale / levelsPerUnitY_;
+  const size_t count = size();
+  const uint32_t* points = points_.get();
+
+  // Every thread reads the whole ring and plots the rows of its band, so no two threads
+  // write the same pixel and nothing needs merging. Compact counters promote whole
+  // blocks, which bands of rows don't line up with, so they take a single band.
+  int bands = pool && !compact ? std::max(1, std::min(pool->concurrency(), h)) : 1;
+  std::vector<uint32_t> bandMaxDensity(bands, 0);
+  std::vector<int64_t> bandPlotted(bands, 0);
+  auto plotBand = [&](int band) {
+    // Whole rows, so every row has exactly one band writing it
+    const int rowBegin = static_cast<int>(static_cast<int64_t>(h) * band / bands);
+    const int rowEnd = static_cast<int>(static_cast<int64_t>(h) * (band + 1) / bands);
+    uint32_t maxDensity = 0;
+    int64_t plotted = 0;
+    withDensitySink(densityPtr, compact, occupancy, nullptr, layout, w, [&](const auto& sink) {
+      for (size_t i = 0; i < count; i++) {
+        uint32_t point = points[i];
+        if (point == kEmpty) {
+          continue;
+        }
+        double sx = originX + (point >> 16) * pixelsPerLevelX;
+        double sy = originY + (point & 0xffff) * pixelsPerLevelY;
+        if (!(sx >= 0.0 && sx < w && sy >= 0.0 && sy < h)) {
+          continue;
+        }
+        int row = static_cast<int>(sy);
+        if (row >= rowBegin && row < rowEnd) {
+          uint32_t value = sink.plot(static_cast<int>(sx), row);
+          maxDensity = std::max(maxDensity, value);
+          plotted++;
+        }
+      }
+    });
+    bandMaxDensity[band] = maxDensity;
+    bandPlotted[band] = plotted;
+  };
+  if (bands > 1) {
+    pool->parallelFor(bands, plotBand);
+  } else {
+    plotBand(0);
+  }
+
+  pointsPlotted = 0;
+  for (int64_t plotted : bandPlotted) {
+    pointsPlotted += plotted;
+  }
+  return *std::max_element(bandMaxDensity.begin(), bandMaxDensity.end());
+}
+
+}  // namespace facebook::react
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "AttractorCore.h"
+#include "CompactDensity.h"
+#include "DensityLayout.h"
+#include "WorkerPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace facebook::react {
+
+class OrbitRecorder;
+
+// Write position of one orbit in the recorder, takes the ring a block at a time
+struct OrbitCursor {
+  explicit OrbitCursor(OrbitRecorder& recorder) : recorder(recorder) {}
+  // Marks the slots of the block it didn't use as empty
+  ~OrbitCursor();
+
+  OrbitCursor(const OrbitCursor&) = delete;
+  OrbitCursor& operator=(const OrbitCursor&) = delete;
+
+  void record(double x, double y);
+
+  OrbitRecorder& recorder;
+  uint32_t* next = nullptr;
+  uint32_t* end = nullptr;
+};
+
+// The points of the orbits, kept so a pan or a new canvas size re-bins them instead of
+// iterating the map again. Orbits of one job record concurrently, a re-bin must not run
+// while a job records.
+//
+// Points are stored in attractor units, after smoothing, quantized to 16 bits per axis
+// over the bounds of the map: 4 bytes a point, in a ring that keeps the newest ones.
+// The smoothing offset depends on the scale, so they only re-bin for the map, a-d and
+// scale they were recorded with. left, top and the canvas size are free.
+class OrbitRecorder {
+ public:
+  // Slots an orbit takes at once, so concurrent orbits don't contend on every point
+  static constexpr size_t kBlockSize = 4096;
+  // Never a quantized point, 0xffff is past the last level of either axis
+  static constexpr uint32_t kEmpty = 0xffffffff;
+  // Blocks of the ring per orbit recording at once. With fewer, a block an orbit still
+  // writes comes round again and another orbit gets it too.
+  static constexpr size_t kMinBlocksPerOrbit = 4;
+
+  // Slots kept for capacity points recorded by up to orbits orbits at once: whole
+  // blocks, and at least kMinBlocksPerOrbit of them per orbit
+  static size_t capacityFor(size_t capacity, int orbits);
+
+  OrbitRecorder(size_t capacity, int orbits, const AttractorParameters& params);
+
+  // True when the points re-bin for params: same map, a-d, scale and precision
+  bool matches(const AttractorParameters& params) const;
+
+  // Slots of the ring in use, empty ones included
+  size_t size() const;
+  size_t capacity() const;
+  size_t bytes() const;
+  void clear();
+
+  // Plots every recorded point into the density of a w x h canvas centred on
+  // (centerX, centerY), on top of what it holds, in bands of rows over the pool when
+  // given one. Marks occupancy when it isn't null. Returns the max density it reached
+  // and sets pointsPlotted to the points that landed on the canvas.
+  uint32_t rebin(
+    uint32_t* densityPtr,
+    CompactDensity* compact,
+    OccupancyMap* occupancy,
+    DensityLayout layout,
+    int w,
+    int h,
+    double centerX,
+    double centerY,
+    int64_t& pointsPlotted,
+    WorkerPool* pool = nullptr
+  ) const;
+
+  uint32_t
+  quantize(double x, double y) const {
+    double qx = std::min(kMaxLevel, std::max(0.0, (x - minX_) * levelsPerUnitX_));
+    double qy = std::min(kMaxLevel, std::max(0.0, (y - minY_) * levelsPerUnitY_));
+    return (static_cast<uint32_t>(qx + 0.5) << 16) | static_cast<uint32_t>(qy + 0.5);
+  }
+
+ private:
+  friend struct OrbitCursor;
+
+  static constexpr double kMaxLevel = 65534.0;
+
+  // Hands the cursor the next block of the ring
+  void reserve(OrbitCursor& cursor);
+
+  AttractorParameters params_;
+  double minX_;
+  double minY_;
+  double levelsPerUnitX_;
+  double levelsPerUnitY_;
+  size_t capacity_;
+  std::unique_ptr<uint32_t[]> points_;
+  std::atomic<uint64_t> written_{0};
+};
+
+inline void
+OrbitCursor::record(double x, double y) {
+  if (next == end) {
+    recorder.reserve(*this);
+  }
+  *next++ = recorder.quantize(x, y);
+}
+
+// Density sink that also keeps every point of the orbit, on the canvas or not
+template <typename Sink>
+struct RecordingSink {
+  Sink sink;
+  OrbitCursor* cursor;
+
+  uint32_t
+  plot(int x, int y) const {
+    return sink.plot(x, y);
+  }
+
+  void
+  record(double x, double y) const {
+    cursor->record(x, y);
+  }
+};
+
+}  // namespace facebook::react
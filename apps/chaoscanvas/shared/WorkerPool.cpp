@@ -0,0 +1,191 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace facebook::react {
+
+WorkerPool::WorkerPool(size_t helperCount, size_t maxQueuedJobs)
+    : maxQueuedJobs_(std::max<size_t>(1, maxQueuedJobs)) {
+  helpers_.reserve(helperCount);
+  for (size_t i = 0; i < helperCount; i++) {
+    helpers_.emplace_back([this]() { helperLoop(); });
+  }
+  dispatcher_ = std::thread([this]() { dispatchLoop(); });
+}
+
+WorkerPool::~WorkerPool() {
+  std::deque<Job> dropped;
+  {
+    std::lock_guard<std::mutex> lock(jobMutex_);
+    stopping_ = true;
+    dropped.swap(jobs_);
+  }
+  jobCondition_.notify_all();
+  for (auto& job : dropped) {
+    if (job.drop) {
+      job.drop();
+    }
+  }
+
+  // The running job, if any, finishes before the helpers are stopped
+  if (dispatcher_.joinable()) {
+    dispatcher_.join();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(batchMutex_);
+    helpersStopping_ = true;
+    batchGeneration_++;
+  }
+  batchCondition_.notify_all();
+  for (auto& helper : helpers_) {
+    helper.join();
+  }
+}
+
+void
+WorkerPool::submit(Job job) {
+  std::vector<Job> dropped;
+  {
+    std::lock_guard<std::mutex> lock(jobMutex_);
+
+    // A new render makes everything still queued for older renders stale
+    for (auto it = jobs_.begin(); it != jobs_.end();) {
+      if (it->key != job.key) {
+        dropped.push_back(std::move(*it));
+        it = jobs_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+
+    if (stopping_ || jobs_.size() >= maxQueuedJobs_) {
+      dropped.push_back(std::move(job));
+    } else {
+      jobs_.push_back(std::move(job));
+    }
+  }
+  jobCondition_.notify_one();
+
+  for (auto& droppedJob : dropped) {
+    if (droppedJob.drop) {
+      droppedJob.drop();
+    }
+  }
+}
+
+void
+WorkerPool::cancel(const std::string& key) {
+  std::vector<Job> dropped;
+  {
+    std::lock_guard<std::mutex> lock(jobMutex_);
+    for (auto it = jobs_.begin(); it != jobs_.end();) {
+      if (it->key == key) {
+        dropped.push_back(std::move(*it));
+        it = jobs_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  for (auto& droppedJob : dropped) {
+    if (droppedJob.drop) {
+      droppedJob.drop();
+    }
+  }
+}
+
+size_t
+WorkerPool::queueDepth() const {
+  std::lock_guard<std::mutex> lock(jobMutex_);
+  return jobs_.size();
+}
+
+int
+WorkerPool::concurrency() const {
+  return static_cast<int>(helpers_.size()) + 1;
+}
+
+void
+WorkerPool::dispatchLoop() {
+  while (true) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(jobMutex_);
+      jobCondition_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+      if (stopping_) {
+        return;
+      }
+      job = std::move(jobs_.front());
+      jobs_.pop_front();
+    }
+    job.run();
+  }
+}
+
+void
+WorkerPool::parallelFor(int count, const std::function<void(int)>& fn) {
+  if (count <= 0) {
+    return;
+  }
+  if (count == 1 || helpers_.empty()) {
+    for (int i = 0; i < count; i++) {
+      fn(i);
+    }
+    return;
+  }
+
+  auto batch = std::make_shared<Batch>();
+  batch->fn = &fn;
+  batch->count = count;
+  {
+    std::lock_guard<std::mutex> lock(batchMutex_);
+    batch_ = batch;
+    batchGeneration_++;
+  }
+  batchCondition_.notify_all();
+
+  runBatch(*batch);
+
+  std::unique_lock<std::mutex> lock(batchMutex_);
+  batchDoneCondition_.wait(lock, [&]() { return batch->done.load() == count; });
+  batch_.reset();
+}
+
+void
+WorkerPool::runBatch(Batch& batch) {
+  // Claim indices until none are left, a late helper claims nothing and never touches fn
+  int index;
+  while ((index = batch.next.fetch_add(1)) < batch.count) {
+    (*batch.fn)(index);
+    if (batch.done.fetch_add(1) + 1 == batch.count) {
+      std::lock_guard<std::mutex> lock(batchMutex_);
+      batchDoneCondition_.notify_all();
+    }
+  }
+}
+
+void
+WorkerPool::helperLoop() {
+  uint64_t seenGeneration = 0;
+  while (true) {
+    std::shared_ptr<Batch> batch;
+    {
+      std::unique_lock<std::mutex> lock(batchMutex_);
+      batchCondition_.wait(lock, [&]() { return batchGeneration_ != seenGeneration; });
+      if (helpersStopping_) {
+        return;
+      }
+      seenGeneration = batchGeneration_;
+      batch = batch_;
+    }
+    // The batch may already be finished and cleared by the time this helper wakes up
+    if (batch) {
+      runBatch(*batch);
+    }
+  }
+}
+
+}  // namespace facebook::react
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace facebook::react {
+
+// Long-lived threads owned by NativeAttractorCalc, or by the native tools.
+//
+// Calculation jobs run one at a time, in submission order, on a dispatcher thread,
+// so overlapping calls from JS never oversubscribe the cores. A job can fan out over
+// the helper threads with parallelFor() without creating threads of its own.
+class WorkerPool {
+ public:
+  struct Job {
+    std::string key;  // timestamp of the render the job belongs to
+    std::function<void()> run;
+    std::function<void()> drop;  // called instead of run when the job is discarded
+  };
+
+  WorkerPool(size_t helperCount, size_t maxQueuedJobs);
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  // Queues a job. Queued jobs of a superseded render (a different key) are dropped,
+  // and the new job is dropped if the queue is still full.
+  void submit(Job job);
+
+  // Drops the queued jobs of a render, a running job has to notice the cancel itself
+  void cancel(const std::string& key);
+
+  // Runs fn(0..count-1) on the helpers and the calling thread, returns when all are done.
+  // Only called from inside a job, or by the owner of a pool it submits no jobs to.
+  void parallelFor(int count, const std::function<void(int)>& fn);
+
+  size_t queueDepth() const;
+
+  // Threads available to parallelFor, the calling thread included
+  int concurrency() const;
+
+ private:
+  struct Batch {
+    const std::function<void(int)>* fn;
+    int count;
+    std::atomic<int> next{0};
+    std::atomic<int> done{0};
+  };
+
+  void dispatchLoop();
+  void helperLoop();
+  void runBatch(Batch& batch);
+
+  const size_t maxQueuedJobs_;
+
+  mutable std::mutex jobMutex_;
+  std::condition_variable jobCondition_;
+  std::deque<Job> jobs_;
+  bool stopping_ = false;
+
+  std::mutex batchMutex_;
+  std::condition_variable batchCondition_;
+  std::condition_variable batchDoneCondition_;
+  std::shared_ptr<Batch> batch_;
+  uint64_t batchGeneration_ = 0;
+  bool helpersStopping_ = false;
+
+  std::thread dispatcher_;
+  std::vector<std::thread> helpers_;
+};
+
+}  // namespace facebook::react
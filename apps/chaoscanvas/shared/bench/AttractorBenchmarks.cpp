@@ -0,0 +1,540 @@
+// Microbenchmarks of the attractor core: map steps, density accumulation, colouring
+// and whole frames. Run with --benchmark_out=<file> --benchmark_out_format=json to
+// record a baseline, items_per_second is the number to compare between releases.
+
+#include "../AttractorCore.h"
+#include "../AttractorSimd.h"
+#include "../CompactDensity.h"
+#include "../DensityPyramid.h"
+#include "../OccupancyMap.h"
+#include "../OrbitRecorder.h"
+#include "../WorkerPool.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace facebook::react;
+
+namespace {
+
+AttractorParameters
+defaultParameters(const std::string& attractor) {
+  // The app's default Clifford attractor, scaled the way the native caller scales it
+  return {
+    .attractor = attractor,
+    .a = 2,
+    .b = -2,
+    .c = 1,
+    .d = -1,
+    .hue = 333,
+    .saturation = 100,
+    .brightness = 100,
+    .background = {0, 0, 0, 255},
+    .scale = 150,
+    .left = 0,
+    .top = 0,
+    .seed = 1,
+  };
+}
+
+// One pool for the whole run, sized like the app's
+WorkerPool&
+sharedPool() {
+  static WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1, 1);
+  return pool;
+}
+
+struct Frame {
+  int width;
+  int height;
+  DensityLayout layout;
+  std::vector<uint32_t> density;
+  std::unique_ptr<CompactDensity> compact;  // replaces density when set
+  std::unique_ptr<OccupancyMap> occupancy;  // marked, cleared and coloured by when set
+  // Marked on every point and cleared by colorize(), which then only recolours the
+  // dirty tiles while maxDensity stays where the last colouring had it
+  std::unique_ptr<OccupancyMap> dirty;
+  int coloredMaxDensity = -1;
+  std::vector<uint32_t> image;
+  int maxDensity = 0;
+  double x = 0;
+  double y = 0;
+
+  Frame(
+    int w,
+    int h,
+    DensityLayout densityLayout = DensityLayout::ROW_MAJOR,
+    bool compactDensity = false
+  )
+      : width(w),
+        height(h),
+        layout(densityLayout),
+        density(compactDensity ? 0 : densityBufferSize(densityLayout, w, h), 0),
+        image(static_cast<size_t>(w) * h, 0) {
+    if (compactDensity) {
+      compact = std::make_unique<CompactDensity>(densityBufferSize(densityLayout, w, h));
+    }
+  }
+
+  size_t
+  densitySize() const {
+    return compact ? compact->size() : density.size();
+  }
+
+  void
+  trackOccupancy() {
+    occupancy = std::make_unique<OccupancyMap>(width, height);
+    occupancy->scan(density.data(), layout);
+  }
+
+  void
+  trackDirtyTiles() {
+    dirty = std::make_unique<OccupancyMap>(width, height);
+  }
+
+  void
+  clear() {
+    if (dirty) {
+      dirty->clear();
+    }
+    coloredMaxDensity = -1;
+    if (occupancy) {
+      occupancy->clearDensity(density.data(), layout);
+    } else {
+      std::fill(density.begin(), density.end(), 0);
+    }
+    if (compact) {
+      compact->clear();
+    }
+    maxDensity = 0;
+    x = 0;
+    y = 0;
+  }
+
+  void
+  accumulate(
+    AttractorCore& core,
+    const AttractorParameters& params,
+    int points,
+    int threadCount,
+    bool useSimd,
+    OrbitRecorder* recorder = nullptr
+  ) {
+    AccumulationContext context = {
+      .densityPtr = density.data(),
+      .densitySize = densitySize(),
+      .maxDensity = maxDensity,
+      .x = x,
+      .y = y,
+      .pointsToCalculate = points,
+      .w = width,
+      .h = height,
+      .attractorParams = params,
+      .centerX = AttractorCore::centerX(params, width),
+      .centerY = AttractorCore::centerY(params, height),
+      .attractorType = AttractorCore::getAttractorType(params.attractor),
+      .layout = layout,
+      .compact = compact.get(),
+      .occupancy = occupancy.get(),
+      .dirty = dirty.get(),
+      .recorder = recorder,
+    };
+    if (threadCount == 0) {
+      core.accumulateDensity(context, *params.seed);
+    } else {
+      core.accumulateDensityParallel(context, threadCount, useSimd);
+    }
+  }
+
+  void
+  colorize(
+    AttractorCore& core,
+    const AttractorParameters& params,
+    bool highQuality,
+    bool parallel = false
+  ) {
+    ImageDataCreationContext context = {
+      .imageData = image.data(),
+      .imageSize = static_cast<int>(image.size()),
+      .densityPtr = density.data(),
+      .densitySize = densitySize(),
+      .maxDensity = maxDensity,
+      .highQuality = highQuality,
+      .attractorParams = params,
+      .layout = layout,
+      .width = width,
+      .height = height,
+      .compact = compact.get(),
+      .occupancy = occupancy.get(),
+      .dirty = dirty.get(),
+      .coloredMaxDensity = coloredMaxDensity,
+      .parallel = parallel,
+    };
+    core.createImageData(context);
+    if (dirty) {
+      dirty->clear();
+      coloredMaxDensity = maxDensity;
+    }
+  }
+};
+
+template <AttractorStep step>
+void
+BM_MapStep(benchmark::State& state) {
+  double x = 0.1;
+  double y = 0.1;
+  for (auto _ : state) {
+    for (int i = 0; i < 1024; i++) {
+      auto next = step(x, y, 2, -2, 1, -1);
+      x = next.first;
+      y = next.second;
+    }
+    benchmark::DoNotOptimize(x);
+    benchmark::DoNotOptimize(y);
+  }
+  state.SetItemsProcessed(state.iterations() * 1024);
+}
+BENCHMARK(BM_MapStep<AttractorCore::clifford>)->Name("BM_CliffordStep");
+BENCHMARK(BM_MapStep<AttractorCore::dejong>)->Name("BM_DejongStep");
+BENCHMARK(BM_MapStep<AttractorCore::clifford<TrigPrecision::FLOAT>>)
+  ->Name("BM_CliffordStep/float");
+BENCHMARK(BM_MapStep<AttractorCore::clifford<TrigPrecision::FAST>>)->Name("BM_CliffordStep/fast");
+
+DensityLayout
+layoutArg(int64_t tiled) {
+  return tiled ? DensityLayout::TILED : DensityLayout::ROW_MAJOR;
+}
+
+// Single orbit, scalar kernel, args: square resolution, tiled layout, compact counters
+void
+BM_AccumulateDensity(benchmark::State& state) {
+  AttractorCore core(sharedPool());
+  AttractorParameters params = defaultParameters("clifford");
+  Frame frame(state.range(0), state.range(0), layoutArg(state.range(1)), state.range(2) != 0);
+  const int points = 1000000;
+  for (auto _ : state) {
+    frame.accumulate(core, params, points, 0, false);
+  }
+  benchmark::DoNotOptimize(frame.density.data());
+  state.SetItemsProcessed(state.iterations() * points);
+}
+BENCHMARK(BM_AccumulateDensity)
+  ->ArgsProduct({{512, 1024, 2048, 4096}, {0, 1}, {0, 1}})
+  ->ArgNames({"size", "tiled", "compact"})
+  ->Unit(benchmark::kMillisecond);
+
+// Every thread of the pool, args: square resolution, SIMD on/off, tiled layout on/off
+void
+BM_AccumulateDensityParallel(benchmark::State& state) {
+  AttractorCore core(sharedPool());
+  AttractorParameters params = defaultParameters("clifford");
+  params.seed.reset();
+  Frame frame(state.range(0), state.range(0), layoutArg(state.range(2)));
+  const int points = 4000000;
+  int threadCount = core.resolveThreadCount(0, points, frame.densitySize());
+  for (auto _ : state) {
+    frame.accumulate(core, params, points, threadCount, state.range(1) != 0);
+  }
+  benchmark::DoNotOptimize(frame.density.data());
+  state.SetItemsProcessed(state.iterations() * points);
+  state.counters["threads"] = threadCount;
+}
+BENCHMARK(BM_AccumulateDensityParallel)
+  ->ArgsProduct({{512, 1024, 2048, 4096}, {0, 1}, {0, 1}})
+  ->ArgNames({"size", "simd", "tiled"})
+  ->Unit(benchmark::kMillisecond);
+
+// Every thread of the pool at 1024x1024, args: TrigPrecision, SIMD on/off
+void
+BM_AccumulatePrecision(benchmark::State& state) {
+  AttractorCore core(sharedPool());
+  AttractorParameters params = defaultParameters("clifford");
+  params.seed.reset();
+  params.precision = static_cast<TrigPrecision>(state.range(0));
+  Frame frame(1024, 1024, DensityLayout::ROW_MAJOR);
+  const int points = 4000000;
+  int threadCount = core.resolveThreadCount(0, points, frame.densitySize());
+  for (auto _ : state) {
+    frame.accumulate(core, params, points, threadCount, state.range(1) != 0);
+  }
+  benchmark::DoNotOptimize(frame.density.data());
+  state.SetItemsProcessed(state.iterations() * points);
+  state.SetLabel(trigPrecisionName(params.precision));
+}
+BENCHMARK(BM_AccumulatePrecision)
+  ->ArgsProduct({{0, 1, 2}, {0, 1}})
+  ->ArgNames({"precision", "simd"})
+  ->Unit(benchmark::kMillisecond);
+
+// One colour per density, the work the palette saves per pixel
+void
+BM_GetColorData(benchmark::State& state) {
+  AttractorCore core(sharedPool());
+  const uint32_t maxDensity = 4096;
+  std::vector<int> background = {0, 0, 0, 255};
+  for (auto _ : state) {
+    for (uint32_t density = 1; density <= maxDensity; density++) {
+      benchmark::DoNotOptimize(
+        core.getColorData(density, maxDensity, 333, 100, 100, 1.0, background)
+      );
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * maxDensity);
+}
+BENCHMARK(BM_GetColorData);
+
+// Density to pixels, args: square resolution, high quality on/off, tiled layout on/off
+void
+BM_CreateImageData(benchmark::State& state) {
+  AttractorCore core(sharedPool());
+  AttractorParameters params = defaultParameters("clifford");
+  Frame frame(state.range(0), state.range(0), layoutArg(state.range(2)));
+  frame.accumulate(core, params, 4000000, 0, false);
+  bool highQuality = state.range(1) != 0;
+  for (auto _ : state) {
+    frame.colorize(core, params, highQuality);
+  }
+  benchmark::DoNotOptimize(frame.image.data());
+  state.SetItemsProcessed(state.iterations() * frame.image.size());
+}
+BENCHMARK(BM_CreateImageData)
+  ->ArgsProduct({{512, 1024, 2048}, {0, 1}, {0, 1}})
+  ->ArgNames({"size", "hq", "tiled"})
+  ->Unit(benchmark::kMillisecond);
+
+// Recolouring after maxDensity moved, which rebuilds the palette every time,
+// args: square resolution, points in millions, colouring on every pool thread on/off
+void
+BM_Recolor(benchmark::State& state) {
+  AttractorCore core(sharedPool());
+  AttractorParameters params = defaultParameters("clifford");
+  params.seed.reset();
+  Frame frame(state.range(0), state.range(0));
+  int points = static_cast<int>(state.range(1)) * 1000000;
+  frame.accumulate(core, params, points, core.resolveThreadCount(0, points, 0), true);
+  int maxDensity = frame.maxDensity;
+  int iteration = 0;
+  for (auto _ : state) {
+    frame.maxDensity = maxDensity + (iteration++ & 1);
+    frame.colorize(core, params, true, state.range(2) != 0);
+  }
+  benchmark::DoNotOptimize(frame.image.data());
+  state.SetItemsProcessed(state.iterations() * frame.image.size());
+  state.counters["maxDensity"] = maxDensity;
+}
+BENCHMARK(BM_Recolor)
+  ->ArgsProduct({{1024, 2048}, {20, 200}, {0, 1}})
+  ->ArgNames({"size", "mpoints", "parallel"})
+  ->Unit(benchmark::kMillisecond);
+
+// Cost of keeping the orbit while accumulating, args: square resolution, recording on/off
+void
+BM_AccumulateRecording(benchmark::State& state) {
+  AttractorCore core(sharedPool());
+  AttractorParameters params = defaultParameters("clifford");
+  params.seed.reset();
+  Frame frame(state.range(0), state.range(0));
+  const int points = 4000000;
+  OrbitRecorder recorder(points, sharedPool().concurrency(), params);
+  int threadCount = core.resolveThreadCount(0, points, frame.densitySize());
+  for (auto _ : state) {
+    frame.accumulate(core, params, points, threadCount, true, state.range(1) ? &recorder : nullptr);
+  }
+  benchmark::DoNotOptimize(frame.density.data());
+  state.SetItemsProcessed(state.iterations() * points);
+}
+BENCHMARK(BM_AccumulateRecording)
+  ->ArgsProduct({{1024}, {0, 1}})
+  ->ArgNames({"size", "record"})
+  ->Unit(benchmark::kMillisecond);
+
+// A pan of a recorded render: the points re-binned at a new offset, args: square resolution
+void
+BM_Rebin(benchmark::State& state) {
+  AttractorCore core(sharedPool());
+  AttractorParameters params = defaultParameters("clifford");
+  params.seed.reset();
+  Frame frame(state.range(0), state.range(0));
+  const int points = 8000000;
+  OrbitRecorder recorder(points, sharedPool().concurrency(), params);
+  frame.accumulate(
+    core, params, points, core.resolveThreadCount(0, points, frame.densitySize()), true, &recorder
+  );
+  for (auto _ : state) {
+    frame.clear();
+    int64_t plotted = 0;
+    recorder.rebin(
+      frame.density.data(),
+      nullptr,
+      nullptr,
+      frame.layout,
+      frame.width,
+      frame.height,
+      frame.width / 2.0 + 10,
+      frame.height / 2.0 - 10,
+      plotted,
+      &sharedPool()
+    );
+  }
+  benchmark::DoNotOptimize(frame.density.data());
+  state.SetItemsProcessed(state.iterations() * recorder.size());
+}
+BENCHMARK(BM_Rebin)->Arg(1024)->Arg(2048)->Unit(benchmark::kMillisecond);
+
+// A whole frame the way the app draws one: clear, accumulate on every thread, colour
+// Clear, accumulate and colour, args: square resolution, scale, occupancy map on/off.
+// Scale 150 covers 9% of the 64x64 tiles at 2048, scale 40 1%.
+void
+BM_Frame(benchmark::State& state) {
+  AttractorCore core(sharedPool());
+  AttractorParameters params = defaultParameters("clifford");
+  params.seed.reset();
+  params.scale = static_cast<double>(state.range(1));
+  Frame frame(state.range(0), state.range(0));
+  if (state.range(2) != 0) {
+    frame.trackOccupancy();
+  }
+  const int points = 4000000;
+  int threadCount = core.resolveThreadCount(0, points, frame.densitySize());
+  for (auto _ : state) {
+    frame.clear();
+    frame.accumulate(core, params, points, threadCount, true);
+    frame.colorize(core, params, true);
+  }
+  benchmark::DoNotOptimize(frame.image.data());
+  state.SetItemsProcessed(state.iterations() * points);
+}
+BENCHMARK(BM_Frame)
+  ->ArgsProduct({{1024, 2048}, {150, 40}, {0, 1}})
+  ->ArgNames({"size", "scale", "occupancy"})
+  ->Unit(benchmark::kMillisecond);
+
+// Clearing and colouring alone, what the occupancy map saves per frame,
+// args: square resolution, scale, occupancy map on/off
+void
+BM_ClearAndColor(benchmark::State& state) {
+  AttractorCore core(sharedPool());
+  AttractorParameters params = defaultParameters("clifford");
+  params.scale = static_cast<double>(state.range(1));
+  Frame frame(state.range(0), state.range(0));
+  if (state.range(2) != 0) {
+    frame.trackOccupancy();
+  }
+  frame.accumulate(core, params, 4000000, 0, false);
+  std::vector<uint32_t> saved = frame.density;
+  int maxDensity = frame.maxDensity;
+  for (auto _ : state) {
+    state.PauseTiming();
+    frame.density = saved;
+    if (frame.occupancy) {
+      frame.occupancy->scan(frame.density.data(), frame.layout);
+    }
+    state.ResumeTiming();
+    frame.colorize(core, params, true);
+    frame.clear();
+    frame.maxDensity = maxDensity;
+  }
+  benchmark::DoNotOptimize(frame.image.data());
+  state.SetItemsProcessed(state.iterations() * frame.image.size());
+}
+BENCHMARK(BM_ClearAndColor)
+  ->ArgsProduct({{1024, 2048, 4096}, {150, 40}, {0, 1}})
+  ->ArgNames({"size", "scale", "occupancy"})
+  ->Unit(benchmark::kMillisecond);
+
+// Redraws of a progressive render that keeps its max density between frames, as the
+// web preview does, args: square resolution, points per redraw, dirty tiles on/off
+void
+BM_ProgressiveRedraw(benchmark::State& state) {
+  AttractorCore core(sharedPool());
+  AttractorParameters params = defaultParameters("clifford");
+  Frame frame(state.range(0), state.range(0));
+  frame.trackOccupancy();
+  if (state.range(2) != 0) {
+    frame.trackDirtyTiles();
+  }
+  frame.accumulate(core, params, 4000000, 0, false);
+  frame.colorize(core, params, true);
+  int heldMaxDensity = frame.maxDensity;
+  for (auto _ : state) {
+    state.PauseTiming();
+    frame.accumulate(core, params, static_cast<int>(state.range(1)), 0, false);
+    frame.maxDensity = heldMaxDensity;
+    state.ResumeTiming();
+    frame.colorize(core, params, true);
+  }
+  benchmark::DoNotOptimize(frame.image.data());
+  state.SetItemsProcessed(state.iterations() * state.range(1));
+}
+BENCHMARK(BM_ProgressiveRedraw)
+  ->ArgsProduct({{1024, 2048}, {2000, 20000, 200000}, {0, 1}})
+  ->ArgNames({"size", "points", "dirty"})
+  ->Unit(benchmark::kMillisecond);
+
+// The first frame of a render, from an empty density to an image, args: square
+// resolution, points, coloured from the pyramid level previewLevel() picks on/off
+void
+BM_FirstFrame(benchmark::State& state) {
+  AttractorCore core(sharedPool());
+  AttractorParameters params = defaultParameters("clifford");
+  params.seed.reset();
+  int size = static_cast<int>(state.range(0));
+  int points = static_cast<int>(state.range(1));
+  Frame frame(size, size);
+  frame.trackOccupancy();
+  DensityPyramid pyramid(size, size);
+  int level = state.range(2) != 0 ? DensityPyramid::previewLevel(points, size, size) : 0;
+  int threadCount = core.resolveThreadCount(0, points, frame.densitySize());
+  for (auto _ : state) {
+    frame.clear();
+    frame.accumulate(core, params, points, threadCount, true);
+    int maxDensity = level > 0
+      ? static_cast<int>(pyramid.build(frame.density.data(), level, frame.occupancy.get()))
+      : frame.maxDensity;
+    ImageDataCreationContext context = {
+      .imageData = frame.image.data(),
+      .imageSize = static_cast<int>(frame.image.size()),
+      .densityPtr = frame.density.data(),
+      .densitySize = frame.densitySize(),
+      .maxDensity = maxDensity,
+      .highQuality = true,
+      .attractorParams = params,
+      .width = size,
+      .height = size,
+      .occupancy = frame.occupancy.get(),
+      .pyramid = &pyramid,
+      .pyramidLevel = level,
+      .parallel = true,
+    };
+    core.createImageData(context);
+  }
+  benchmark::DoNotOptimize(frame.image.data());
+  state.counters["level"] = level;
+  state.SetItemsProcessed(state.iterations() * points);
+}
+BENCHMARK(BM_FirstFrame)
+  ->ArgsProduct({{1024, 2048}, {20000, 200000}, {0, 1}})
+  ->ArgNames({"size", "points", "coarse"})
+  ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+int
+main(int argc, char** argv) {
+  // Recorded in the JSON context, so results from different machines can be told apart
+  benchmark::AddCustomContext("simd", simdLevelName(detectSimdLevel()));
+  benchmark::AddCustomContext("pool_threads", std::to_string(sharedPool().concurrency()));
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,298 @@
+#include "ImageWriter.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+#ifdef ATTRACTOR_CLI_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace facebook::react {
+
+namespace {
+
+using FilePtr = std::unique_ptr<FILE, int (*)(FILE*)>;
+
+FilePtr
+openForWriting(const std::string& path) {
+  FilePtr file(std::fopen(path.c_str(), "wb"), &std::fclose);
+  if (!file) {
+    throw std::runtime_error("Cannot open " + path + " for writing");
+  }
+  return file;
+}
+
+void
+writeBytes(FILE* file, const void* data, size_t size) {
+  if (size > 0 && std::fwrite(data, 1, size, file) != size) {
+    throw std::runtime_error("Failed to write image data");
+  }
+}
+
+void
+closeFile(FilePtr& file) {
+  if (std::fclose(file.release()) != 0) {
+    throw std::runtime_error("Failed to write image data");
+  }
+}
+
+uint32_t
+crc32Update(uint32_t crc, const uint8_t* data, size_t size) {
+  static const std::array<uint32_t, 256> table = []() {
+    std::array<uint32_t, 256> entries{};
+    for (uint32_t n = 0; n < 256; n++) {
+      uint32_t c = n;
+      for (int k = 0; k < 8; k++) {
+        c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+      }
+      entries[n] = c;
+    }
+    return entries;
+  }();
+
+  crc = ~crc;
+  for (size_t i = 0; i < size; i++) {
+    crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+void
+appendBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+  out.push_back(value >> 24);
+  out.push_back(value >> 16);
+  out.push_back(value >> 8);
+  out.push_back(value);
+}
+
+void
+writeChunk(FILE* file, const char* type, const uint8_t* data, size_t size) {
+  std::vector<uint8_t> chunk;
+  chunk.reserve(size + 12);
+  appendBigEndian(chunk, static_cast<uint32_t>(size));
+  chunk.insert(chunk.end(), type, type + 4);
+  chunk.insert(chunk.end(), data, data + size);
+  appendBigEndian(chunk, crc32Update(0, chunk.data() + 4, chunk.size() - 4));
+  writeBytes(file, chunk.data(), chunk.size());
+}
+
+// Compressed data is cut into IDAT chunks of this size
+const size_t kIdatChunkSize = 256 * 1024;
+
+// zlib stream of the scanlines, fed a row at a time
+class ScanlineDeflater {
+ public:
+  ScanlineDeflater() {
+#ifdef ATTRACTOR_CLI_HAVE_ZLIB
+    stream_ = {};
+    out_.resize(kIdatChunkSize);
+    if (deflateInit(&stream_, Z_DEFAULT_COMPRESSION) != Z_OK) {
+      throw std::runtime_error("Failed to initialise zlib");
+    }
+#else
+    out_ = {0x78, 0x01};
+#endif
+  }
+
+  ~ScanlineDeflater() {
+#ifdef ATTRACTOR_CLI_HAVE_ZLIB
+    deflateEnd(&stream_);
+#endif
+  }
+
+  ScanlineDeflater(const ScanlineDeflater&) = delete;
+  ScanlineDeflater& operator=(const ScanlineDeflater&) = delete;
+
+  // Compresses data, complete output chunks are passed to emit
+  template <typename Emit>
+  void
+  add(const uint8_t* data, size_t size, bool last, Emit&& emit) {
+#ifdef ATTRACTOR_CLI_HAVE_ZLIB
+    stream_.next_in = const_cast<Bytef*>(data);
+    stream_.avail_in = static_cast<uInt>(size);
+    std::vector<uint8_t>& buffer = out_;
+    int status;
+    do {
+      stream_.next_out = buffer.data();
+      stream_.avail_out = static_cast<uInt>(buffer.size());
+      status = deflate(&stream_, last ? Z_FINISH : Z_NO_FLUSH);
+      if (status == Z_STREAM_ERROR) {
+        throw std::runtime_error("Failed to compress image data");
+      }
+      size_t produced = buffer.size() - stream_.avail_out;
+      if (produced > 0) {
+        emit(buffer.data(), produced);
+      }
+    } while (stream_.avail_out == 0 || (last && status != Z_STREAM_END));
+#else
+    // Without zlib the scanlines go out as stored (uncompressed) deflate blocks
+    const size_t kMaxBlock = 65535;
+    for (size_t i = 0; i < size; i++) {
+      s1_ = (s1_ + data[i]) % 65521;
+      s2_ = (s2_ + s1_) % 65521;
+    }
+    pending_.insert(pending_.end(), data, data + size);
+    while (pending_.size() >= kMaxBlock || (last && !pending_.empty())) {
+      storeBlock(std::min(kMaxBlock, pending_.size()), false);
+    }
+    if (last) {
+      storeBlock(0, true);
+      appendBigEndian(out_, (s2_ << 16) | s1_);
+    }
+    if (out_.size() >= kIdatChunkSize || (last && !out_.empty())) {
+      emit(out_.data(), out_.size());
+      out_.clear();
+    }
+#endif
+  }
+
+ private:
+#ifdef ATTRACTOR_CLI_HAVE_ZLIB
+  z_stream stream_;
+  std::vector<uint8_t> out_;
+#else
+  void
+  storeBlock(size_t size, bool final) {
+    out_.push_back(final ? 1 : 0);
+    out_.push_back(size & 0xff);
+    out_.push_back(size >> 8);
+    out_.push_back(~size & 0xff);
+    out_.push_back((~size >> 8) & 0xff);
+    out_.insert(out_.end(), pending_.begin(), pending_.begin() + size);
+    pending_.erase(pending_.begin(), pending_.begin() + size);
+  }
+
+  std::vector<uint8_t> pending_;
+  std::vector<uint8_t> out_;
+  uint32_t s1_ = 1;
+  uint32_t s2_ = 0;
+#endif
+};
+
+class PngStreamWriter : public ImageStreamWriter {
+ public:
+  PngStreamWriter(const std::string& path, int width, int height)
+      : file_(openForWriting(path)), width_(width), height_(height) {
+    static const uint8_t kSignature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    writeBytes(file_.get(), kSignature, sizeof(kSignature));
+
+    std::vector<uint8_t> header;
+    appendBigEndian(header, width);
+    appendBigEndian(header, height);
+    header.insert(header.end(), {8, 6, 0, 0, 0});  // 8-bit RGBA, no interlace
+    writeChunk(file_.get(), "IHDR", header.data(), header.size());
+  }
+
+  void
+  writeRows(const uint32_t* pixels, int rows) override {
+    if (rows > height_ - rowsWritten_) {
+      throw std::runtime_error("Image stream written past its last row");
+    }
+    // Filter type 0 on every row, pixels are already RGBA in memory order
+    std::vector<uint8_t> row(static_cast<size_t>(width_) * 4 + 1);
+    for (int y = 0; y < rows; y++) {
+      row[0] = 0;
+      const uint32_t* src = pixels + static_cast<size_t>(y) * width_;
+      for (int x = 0; x < width_; x++) {
+        row[1 + x * 4] = src[x] & 0xff;
+        row[2 + x * 4] = (src[x] >> 8) & 0xff;
+        row[3 + x * 4] = (src[x] >> 16) & 0xff;
+        row[4 + x * 4] = src[x] >> 24;
+      }
+      rowsWritten_++;
+      bool last = rowsWritten_ == height_;
+      deflater_.add(row.data(), row.size(), last, [&](const uint8_t* data, size_t size) {
+        writeChunk(file_.get(), "IDAT", data, size);
+      });
+    }
+  }
+
+  void
+  finish() override {
+    if (rowsWritten_ != height_) {
+      throw std::runtime_error("Image stream finished before its last row");
+    }
+    writeChunk(file_.get(), "IEND", nullptr, 0);
+    closeFile(file_);
+  }
+
+ private:
+  FilePtr file_;
+  int width_;
+  int height_;
+  int rowsWritten_ = 0;
+  ScanlineDeflater deflater_;
+};
+
+class PpmStreamWriter : public ImageStreamWriter {
+ public:
+  PpmStreamWriter(const std::string& path, int width, int height)
+      : file_(openForWriting(path)), width_(width), height_(height) {
+    std::string header =
+      "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+    writeBytes(file_.get(), header.data(), header.size());
+  }
+
+  void
+  writeRows(const uint32_t* pixels, int rows) override {
+    if (rows > height_ - rowsWritten_) {
+      throw std::runtime_error("Image stream written past its last row");
+    }
+    std::vector<uint8_t> row(static_cast<size_t>(width_) * 3);
+    for (int y = 0; y < rows; y++) {
+      const uint32_t* src = pixels + static_cast<size_t>(y) * width_;
+      for (int x = 0; x < width_; x++) {
+        row[x * 3] = src[x] & 0xff;
+        row[x * 3 + 1] = (src[x] >> 8) & 0xff;
+        row[x * 3 + 2] = (src[x] >> 16) & 0xff;
+      }
+      writeBytes(file_.get(), row.data(), row.size());
+    }
+    rowsWritten_ += rows;
+  }
+
+  void
+  finish() override {
+    if (rowsWritten_ != height_) {
+      throw std::runtime_error("Image stream finished before its last row");
+    }
+    closeFile(file_);
+  }
+
+ private:
+  FilePtr file_;
+  int width_;
+  int height_;
+  int rowsWritten_ = 0;
+};
+
+bool
+hasExtension(const std::string& path, const std::string& extension) {
+  return path.size() >= extension.size() &&
+    path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+}  // namespace
+
+std::unique_ptr<ImageStreamWriter>
+openImageStream(const std::string& path, int width, int height) {
+  if (hasExtension(path, ".png")) {
+    return std::make_unique<PngStreamWriter>(path, width, height);
+  }
+  if (hasExtension(path, ".ppm")) {
+    return std::make_unique<PpmStreamWriter>(path, width, height);
+  }
+  throw std::runtime_error("Unsupported image format: " + path);
+}
+
+void
+writeImage(const std::string& path, const uint32_t* pixels, int width, int height) {
+  auto stream = openImageStream(path, width, height);
+  stream->writeRows(pixels, height);
+  stream->finish();
+}
+
+}  // namespace facebook::react
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace facebook::react {
+
+// Encodes a frame of 0xAABBGGRR pixels, the layout createImageData produces, a band of
+// rows at a time, so an image never has to be held in memory whole. The format follows
+// the extension: PNG keeps the alpha channel, PPM drops it.
+// Throws std::runtime_error on I/O errors.
+class ImageStreamWriter {
+ public:
+  virtual ~ImageStreamWriter() = default;
+
+  // Appends the next rows, pixels holds rows * width of them
+  virtual void writeRows(const uint32_t* pixels, int rows) = 0;
+  // Flushes the encoder, every row of the image must have been written
+  virtual void finish() = 0;
+};
+
+std::unique_ptr<ImageStreamWriter>
+openImageStream(const std::string& path, int width, int height);
+
+// Writes a whole frame in one go
+void writeImage(const std::string& path, const uint32_t* pixels, int width, int height);
+
+}  // namespace facebook::react
@@ -0,0 +1,731 @@
+// Headless renderer built from the same iteration and colouring code as the app.
+//
+//   attractor-cli --attractor clifford --a 2 --b -2 --c 1 --d -1
+//     --width 1920 --height 1080 --points 100000000 --output out.png
+//
+// Posters larger than memory: add --band-rows 256 (implies a seed, printed if not given).
+// Stop once more points stop changing the image: add --converge 0.004.
+//
+// Animations interpolate a, b, c and d between keyframes, one image per frame or raw
+// RGBA frames to pipe into an encoder:
+//
+//   attractor-cli --frames 120 --keyframe 0:2,-2,1,-1 --keyframe 119:1.7,1.7,0.6,1.2
+//     --width 1280 --height 720 --points 5000000 --output - |
+//     ffmpeg -f rawvideo -pix_fmt rgba -s 1280x720 -r 30 -i - out.mp4
+
+#include "../AnimationRenderer.h"
+#include "../AttractorCore.h"
+#include "../AttractorSimd.h"
+#include "../CompactDensity.h"
+#include "../ConvergenceTracker.h"
+#include "../OccupancyMap.h"
+#include "../WorkerPool.h"
+#include "ImageWriter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <random>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace facebook::react;
+
+namespace {
+
+struct CliOptions {
+  AttractorParameters params = {
+    .attractor = "clifford",
+    .a = 2,
+    .b = -2,
+    .c = 1,
+    .d = -1,
+    .hue = 333,
+    .saturation = 100,
+    .brightness = 100,
+    .background = {0, 0, 0, 255},
+    .scale = 150,
+    .left = 0,
+    .top = 0,
+    .seed = std::nullopt,
+  };
+  int width = 1024;
+  int height = 1024;
+  int64_t points = 20000000;
+  int threads = 0;  // 0 uses every core
+  bool useSimd = true;
+  bool highQuality = true;
+  DensityLayout layout = DensityLayout::ROW_MAJOR;
+  bool compact = false;
+  int bandRows = 0;  // 0 renders the whole canvas at once
+  double converge = 0;  // stops early once a doubling changes less than this, 0 is off
+  int frames = 0;       // renders an animation of this many frames, 0 renders one image
+  // frame:a,b,c,d, the other parameters are the ones given above
+  std::vector<std::pair<int, std::vector<double>>> keyframes;
+  std::string output = "attractor.png";
+};
+
+const char* kUsage =
+  "Usage: attractor-cli [options]\n"
+  "  --attractor clifford|dejong  attractor map (clifford)\n"
+  "  --a --b --c --d <value>      map parameters (2, -2, 1, -1)\n"
+  "  --hue <0-359>                colour hue (333)\n"
+  "  --saturation <0-100>         colour saturation (100)\n"
+  "  --brightness <0-100>         colour brightness (100)\n"
+  "  --background r,g,b[,a]       background colour (0,0,0,255)\n"
+  "  --width --height <pixels>    image size (1024x1024)\n"
+  "  --points <count>             points to plot (20000000)\n"
+  "  --scale <pixels>             pixels per attractor unit (150)\n"
+  "  --left --top <fraction>      offset of the attractor centre in canvas sizes (0, 0)\n"
+  "  --seed <integer>             deterministic smoothing coins\n"
+  "  --precision exact|float|fast sin/cos accuracy of the map (exact)\n"
+  "  --threads <count>            worker threads, 0 uses every core (0)\n"
+  "  --no-simd                    force the scalar kernel\n"
+  "  --low-quality                flat colour instead of the density palette\n"
+  "  --layout row-major|tiled     density buffer memory order (row-major)\n"
+  "  --compact                    16-bit density counters, wider only where needed\n"
+  "  --band-rows <rows>           render in bands of rows to bound memory (off)\n"
+  "  --converge <change>          stop once doubling the points changes less (off)\n"
+  "  --frames <count>             render an animation of this many frames (off)\n"
+  "  --keyframe <frame:a,b,c,d>   map parameters at a frame of the animation, repeatable\n"
+  "  --output <file.png|file.ppm> output image (attractor.png); animations take a\n"
+  "                               pattern like frame-%04d.png, or file.rgba or - for\n"
+  "                               raw RGBA frames\n";
+
+double
+parseNumber(const std::string& name, const std::string& value) {
+  try {
+    size_t used = 0;
+    double number = std::stod(value, &used);
+    if (used == value.size()) {
+      return number;
+    }
+  } catch (const std::exception&) {
+  }
+  throw std::runtime_error("Invalid value for " + name + ": " + value);
+}
+
+std::vector<int>
+parseColor(const std::string& value) {
+  std::vector<int> color;
+  std::stringstream stream(value);
+  std::string part;
+  while (std::getline(stream, part, ',')) {
+    color.push_back(static_cast<int>(parseNumber("--background", part)));
+  }
+  if (color.size() < 3 || color.size() > 4) {
+    throw std::runtime_error("--background expects r,g,b or r,g,b,a");
+  }
+  if (color.size() == 3) {
+    color.push_back(255);
+  }
+  return color;
+}
+
+// frame:a,b,c,d
+std::pair<int, std::vector<double>>
+parseKeyframe(const std::string& value) {
+  size_t colon = value.find(':');
+  if (colon == std::string::npos) {
+    throw std::runtime_error("--keyframe expects frame:a,b,c,d");
+  }
+  int frame = static_cast<int>(parseNumber("--keyframe", value.substr(0, colon)));
+  std::vector<double> map;
+  std::stringstream stream(value.substr(colon + 1));
+  std::string part;
+  while (std::getline(stream, part, ',')) {
+    map.push_back(parseNumber("--keyframe", part));
+  }
+  if (map.size() != 4) {
+    throw std::runtime_error("--keyframe expects frame:a,b,c,d");
+  }
+  return {frame, map};
+}
+
+bool
+endsWith(const std::string& value, const std::string& suffix) {
+  return value.size() >= suffix.size() &&
+    value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// One %d, optionally zero padded, and no other conversion
+bool
+isFramePattern(const std::string& path) {
+  static const std::regex pattern("[^%]*%0?[0-9]*d[^%]*");
+  return std::regex_match(path, pattern);
+}
+
+CliOptions
+parseArguments(int argc, char** argv) {
+  CliOptions options;
+  AttractorParameters& params = options.params;
+  for (int i = 1; i < argc; i++) {
+    std::string name = argv[i];
+    if (name == "--help" || name == "-h") {
+      std::fputs(kUsage, stdout);
+      std::exit(0);
+    }
+    if (name == "--no-simd") {
+      options.useSimd = false;
+      continue;
+    }
+    if (name == "--low-quality") {
+      options.highQuality = false;
+      continue;
+    }
+    if (name == "--compact") {
+      options.compact = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      throw std::runtime_error("Missing value for " + name);
+    }
+    std::string value = argv[++i];
+
+    if (name == "--attractor") {
+      params.attractor = value;
+    } else if (name == "--a") {
+      params.a = parseNumber(name, value);
+    } else if (name == "--b") {
+      params.b = parseNumber(name, value);
+    } else if (name == "--c") {
+      params.c = parseNumber(name, value);
+    } else if (name == "--d") {
+      params.d = parseNumber(name, value);
+    } else if (name == "--hue") {
+      params.hue = parseNumber(name, value);
+    } else if (name == "--saturation") {
+      params.saturation = parseNumber(name, value);
+    } else if (name == "--brightness") {
+      params.brightness = parseNumber(name, value);
+    } else if (name == "--background") {
+      params.background = parseColor(value);
+    } else if (name == "--scale") {
+      params.scale = parseNumber(name, value);
+    } else if (name == "--left") {
+      params.left = parseNumber(name, value);
+    } else if (name == "--top") {
+      params.top = parseNumber(name, value);
+    } else if (name == "--seed") {
+      params.seed = std::stoull(value);
+    } else if (name == "--precision") {
+      std::optional<TrigPrecision> precision = parseTrigPrecision(value);
+      if (!precision) {
+        throw std::runtime_error("--precision must be exact, float or fast");
+      }
+      params.precision = *precision;
+    } else if (name == "--width") {
+      options.width = static_cast<int>(parseNumber(name, value));
+    } else if (name == "--height") {
+      options.height = static_cast<int>(parseNumber(name, value));
+    } else if (name == "--points") {
+      options.points = static_cast<int64_t>(parseNumber(name, value));
+    } else if (name == "--threads") {
+      options.threads = static_cast<int>(parseNumber(name, value));
+    } else if (name == "--layout") {
+      if (value == "tiled") {
+        options.layout = DensityLayout::TILED;
+      } else if (value == "row-major") {
+        options.layout = DensityLayout::ROW_MAJOR;
+      } else {
+        throw std::runtime_error("--layout must be tiled or row-major");
+      }
+    } else if (name == "--band-rows") {
+      options.bandRows = static_cast<int>(parseNumber(name, value));
+    } else if (name == "--frames") {
+      options.frames = static_cast<int>(parseNumber(name, value));
+    } else if (name == "--keyframe") {
+      options.keyframes.push_back(parseKeyframe(value));
+    } else if (name == "--converge") {
+      options.converge = parseNumber(name, value);
+    } else if (name == "--output") {
+      options.output = value;
+    } else {
+      throw std::runtime_error("Unknown option " + name);
+    }
+  }
+
+  if (options.width <= 0 || options.height <= 0) {
+    throw std::runtime_error("--width and --height must be positive");
+  }
+  if (options.bandRows < 0) {
+    throw std::runtime_error("--band-rows must not be negative");
+  }
+  if (options.converge < 0) {
+    throw std::runtime_error("--converge must not be negative");
+  }
+  if (options.converge > 0 && options.bandRows > 0) {
+    throw std::runtime_error("--converge needs the whole canvas, it can't be used with bands");
+  }
+  if (options.points <= 0) {
+    throw std::runtime_error("--points must be positive");
+  }
+  if (params.scale <= 0) {
+    throw std::runtime_error("--scale must be positive");
+  }
+  if (options.frames < 0) {
+    throw std::runtime_error("--frames must not be negative");
+  }
+  if (options.frames > 0) {
+    // Animation frames are row-major uint32_t densities of a fixed budget each
+    if (options.bandRows > 0 || options.converge > 0) {
+      throw std::runtime_error("--frames can't be combined with --band-rows or --converge");
+    }
+    if (options.layout != DensityLayout::ROW_MAJOR || options.compact) {
+      throw std::runtime_error("--frames can't be combined with --layout tiled or --compact");
+    }
+    if (options.points > INT_MAX) {
+      throw std::runtime_error("--points per frame must fit in 32 bits");
+    }
+    bool raw = options.output == "-" || endsWith(options.output, ".rgba");
+    if (!raw && !isFramePattern(options.output)) {
+      throw std::runtime_error("--frames needs --output with a %d pattern, a .rgba file or -");
+    }
+    if (raw) {
+      return options;
+    }
+  } else if (!options.keyframes.empty()) {
+    throw std::runtime_error("--keyframe needs --frames");
+  }
+  if (!endsWith(options.output, ".png") && !endsWith(options.output, ".ppm")) {
+    throw std::runtime_error("--output must end in .png or .ppm");
+  }
+  return options;
+}
+
+double
+millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+    .count();
+}
+
+// Points before the first convergence check, every later chunk doubles the total
+const int64_t kFirstConvergenceCheck = 1 << 20;
+
+// Runs the point budget over rows [top, top + rows) of the canvas. Points outside the
+// rows are dropped by the kernel's bounds check. Returns the thread count it used.
+// A checkpoint is called with the points done after every chunk and ends the run early
+// by returning true, its chunks double the total each time.
+int
+accumulateRows(
+  AttractorCore& core,
+  const CliOptions& options,
+  int top,
+  int rows,
+  uint32_t* densityPtr,
+  CompactDensity* compact,
+  OccupancyMap* occupancy,
+  int& maxDensity,
+  int64_t& pointsDone,
+  const std::function<bool(int64_t)>& checkpoint = nullptr
+) {
+  const AttractorParameters& params = options.params;
+  AttractorType attractorType = AttractorCore::getAttractorType(params.attractor);
+  size_t densitySize = densityBufferSize(options.layout, options.width, rows);
+  double x = 0;
+  double y = 0;
+  int threadCount = 0;
+
+  // The core counts points in int, so bigger budgets run in consecutive chunks of one orbit
+  const int64_t kMaxChunk = 1 << 30;
+  for (pointsDone = 0; pointsDone < options.points;) {
+    int64_t wanted = options.points - pointsDone;
+    if (checkpoint) {
+      wanted = std::min(wanted, std::max(kFirstConvergenceCheck, pointsDone));
+    }
+    int chunk = static_cast<int>(std::min(kMaxChunk, wanted));
+    threadCount = core.resolveThreadCount(options.threads, chunk, densitySize);
+    AccumulationContext context = {
+      .densityPtr = densityPtr,
+      .densitySize = densitySize,
+      .maxDensity = maxDensity,
+      .x = x,
+      .y = y,
+      .pointsToCalculate = chunk,
+      .w = options.width,
+      .h = rows,
+      .attractorParams = params,
+      .centerX = AttractorCore::centerX(params, options.width),
+      .centerY = AttractorCore::centerY(params, options.height) - top,
+      .attractorType = attractorType,
+      .layout = options.layout,
+      .compact = compact,
+      .occupancy = occupancy,
+    };
+    core.accumulateDensityParallel(context, threadCount, options.useSimd);
+    pointsDone += chunk;
+    if (checkpoint && checkpoint(pointsDone)) {
+      break;
+    }
+  }
+  return threadCount;
+}
+
+void
+colorRows(
+  AttractorCore& core,
+  const CliOptions& options,
+  int rows,
+  const uint32_t* densityPtr,
+  const CompactDensity* compact,
+  const OccupancyMap* occupancy,
+  int maxDensity,
+  uint32_t* image
+) {
+  ImageDataCreationContext imageContext = {
+    .imageData = image,
+    .imageSize = options.width * rows,
+    .densityPtr = densityPtr,
+    .densitySize = densityBufferSize(options.layout, options.width, rows),
+    .maxDensity = maxDensity,
+    .highQuality = options.highQuality,
+    .attractorParams = options.params,
+    .layout = options.layout,
+    .width = options.width,
+    .height = rows,
+    .compact = compact,
+    .occupancy = occupancy,
+    .parallel = true,
+  };
+  core.createImageData(imageContext);
+}
+
+struct RenderStats {
+  int threadCount = 0;
+  int maxDensity = 0;
+  int bands = 1;
+  int bandRows = 0;
+  int64_t points = 0;  // per band
+  bool converged = false;
+  size_t densityBytes = 0;
+  size_t occupiedTiles = 0;  // 0 in poster mode, which doesn't track them
+  size_t tiles = 0;
+  double accumulateMs = 0;
+  double colorMs = 0;
+  double writeMs = 0;
+};
+
+RenderStats
+renderWhole(AttractorCore& core, const CliOptions& options) {
+  RenderStats stats;
+  size_t densitySize = densityBufferSize(options.layout, options.width, options.height);
+  std::vector<uint32_t> density(options.compact ? 0 : densitySize, 0);
+  std::unique_ptr<CompactDensity> compact;
+  if (options.compact) {
+    compact = std::make_unique<CompactDensity>(densitySize);
+  }
+  std::vector<uint32_t> image(static_cast<size_t>(options.width) * options.height, 0);
+  OccupancyMap occupancy(options.width, options.height);
+
+  std::function<bool(int64_t)> checkpoint;
+  ConvergenceTracker tracker(options.converge);
+  if (options.converge > 0) {
+    checkpoint = [&](int64_t pointsDone) {
+      auto densityAt = [&](size_t i) { return compact ? compact->get(i) : density[i]; };
+      return tracker.update(densityAt, densitySize, stats.maxDensity, pointsDone);
+    };
+  }
+
+  auto accumulateStart = std::chrono::steady_clock::now();
+  stats.threadCount = accumulateRows(
+    core,
+    options,
+    0,
+    options.height,
+    density.data(),
+    compact.get(),
+    &occupancy,
+    stats.maxDensity,
+    stats.points,
+    checkpoint
+  );
+  stats.converged = tracker.converged();
+  stats.occupiedTiles = occupancy.occupiedTiles();
+  stats.tiles = static_cast<size_t>(occupancy.tilesPerRow()) * occupancy.tileRows();
+  stats.accumulateMs = millisecondsSince(accumulateStart);
+  stats.densityBytes = compact ? compact->bytes() : densitySize * sizeof(uint32_t);
+
+  auto colorStart = std::chrono::steady_clock::now();
+  colorRows(
+    core,
+    options,
+    options.height,
+    density.data(),
+    compact.get(),
+    &occupancy,
+    stats.maxDensity,
+    image.data()
+  );
+  stats.colorMs = millisecondsSince(colorStart);
+
+  auto writeStart = std::chrono::steady_clock::now();
+  writeImage(options.output, image.data(), options.width, options.height);
+  stats.writeMs = millisecondsSince(writeStart);
+  return stats;
+}
+
+// Poster mode: only one band of rows is in memory at a time.
+//
+// Every band replays the whole seeded orbit and keeps the points that land in it, and
+// spills its density to a temporary file. Colours depend on the global max density, so
+// the bands are coloured and streamed to the encoder once all of them are known.
+RenderStats
+renderBands(AttractorCore& core, const CliOptions& options) {
+  RenderStats stats;
+  int bandRows = std::min(options.bandRows, options.height);
+  size_t maxBandSize = AttractorCore::maxSeededDensitySize();
+  while (bandRows > 1 && densityBufferSize(options.layout, options.width, bandRows) > maxBandSize) {
+    bandRows /= 2;
+  }
+  if (densityBufferSize(options.layout, options.width, bandRows) > maxBandSize) {
+    throw std::runtime_error("--width is too large for banded rendering");
+  }
+  stats.bands = (options.height + bandRows - 1) / bandRows;
+  stats.bandRows = bandRows;
+
+  using FilePtr = std::unique_ptr<FILE, int (*)(FILE*)>;
+  FilePtr spill(std::tmpfile(), &std::fclose);
+  if (!spill) {
+    throw std::runtime_error("Cannot create a temporary file for the density bands");
+  }
+
+  // Spilled and coloured a slice of up to a tile row at a time. A band in either layout
+  // is its slices one after the other, so compact counters never need a band of
+  // uint32_t counts next to them, and the image is only a slice.
+  const int sliceRows = std::min(bandRows, kDensityTileSize);
+  size_t sliceSize = densityBufferSize(options.layout, options.width, sliceRows);
+  size_t bandSize = densityBufferSize(options.layout, options.width, bandRows);
+  std::vector<uint32_t> density(options.compact ? sliceSize : bandSize);
+  std::unique_ptr<CompactDensity> compact;
+
+  auto spillDensity = [&](const uint32_t* values, size_t count) {
+    if (std::fwrite(values, sizeof(uint32_t), count, spill.get()) != count) {
+      throw std::runtime_error("Failed to write the density spill file");
+    }
+  };
+
+  auto accumulateStart = std::chrono::steady_clock::now();
+  for (int top = 0; top < options.height; top += bandRows) {
+    int rows = std::min(bandRows, options.height - top);
+    size_t size = densityBufferSize(options.layout, options.width, rows);
+    int bandMaxDensity = 0;
+    if (options.compact) {
+      // Freed first, so the old band and the new one are never both held
+      compact.reset();
+      compact = std::make_unique<CompactDensity>(size);
+    } else {
+      std::fill(density.begin(), density.end(), 0);
+    }
+    stats.threadCount = accumulateRows(
+      core, options, top, rows, density.data(), compact.get(), nullptr, bandMaxDensity, stats.points
+    );
+    if (compact) {
+      for (size_t begin = 0; begin < size; begin += sliceSize) {
+        size_t count = std::min(sliceSize, size - begin);
+        for (size_t i = 0; i < count; i++) {
+          density[i] = compact->get(begin + i);
+        }
+        spillDensity(density.data(), count);
+      }
+      stats.densityBytes =
+        std::max(stats.densityBytes, compact->bytes() + sliceSize * sizeof(uint32_t));
+    } else {
+      spillDensity(density.data(), size);
+    }
+    stats.maxDensity = std::max(stats.maxDensity, bandMaxDensity);
+  }
+  stats.accumulateMs = millisecondsSince(accumulateStart);
+  compact.reset();
+  if (!options.compact) {
+    stats.densityBytes = bandSize * sizeof(uint32_t);
+  }
+
+  auto stream = openImageStream(options.output, options.width, options.height);
+  std::vector<uint32_t> image(static_cast<size_t>(options.width) * sliceRows);
+  std::rewind(spill.get());
+  for (int top = 0; top < options.height; top += bandRows) {
+    int rows = std::min(bandRows, options.height - top);
+    for (int sliceTop = 0; sliceTop < rows; sliceTop += sliceRows) {
+      int slice = std::min(sliceRows, rows - sliceTop);
+      size_t size = densityBufferSize(options.layout, options.width, slice);
+      if (std::fread(density.data(), sizeof(uint32_t), size, spill.get()) != size) {
+        throw std::runtime_error("Failed to read the density spill file");
+      }
+
+      auto colorStart = std::chrono::steady_clock::now();
+      colorRows(
+        core, options, slice, density.data(), nullptr, nullptr, stats.maxDensity, image.data()
+      );
+      stats.colorMs += millisecondsSince(colorStart);
+
+      auto writeStart = std::chrono::steady_clock::now();
+      stream->writeRows(image.data(), slice);
+      stats.writeMs += millisecondsSince(writeStart);
+    }
+  }
+  auto finishStart = std::chrono::steady_clock::now();
+  stream->finish();
+  stats.writeMs += millisecondsSince(finishStart);
+  return stats;
+}
+
+// The frame's file name from a printf pattern such as frame-%04d.png
+std::string
+framePath(const std::string& pattern, int frame) {
+  std::vector<char> path(pattern.size() + 32);
+  std::snprintf(path.data(), path.size(), pattern.c_str(), frame);
+  return path.data();
+}
+
+int
+renderFrames(const CliOptions& options) {
+  AnimationOptions animation = {
+    .keyframes = {},
+    .frameCount = options.frames,
+    .width = options.width,
+    .height = options.height,
+    .pointsPerFrame = static_cast<int>(options.points),
+    .highQuality = options.highQuality,
+    .useSimd = options.useSimd,
+  };
+  for (const auto& [frame, map] : options.keyframes) {
+    AttractorParameters params = options.params;
+    params.a = map[0];
+    params.b = map[1];
+    params.c = map[2];
+    params.d = map[3];
+    animation.keyframes.push_back({frame, params});
+  }
+  if (animation.keyframes.empty()) {
+    animation.keyframes.push_back({0, options.params});
+  }
+
+  // Frames run one per thread, with no helper set aside for the caller
+  size_t cores = std::max(1u, std::thread::hardware_concurrency());
+  size_t threads = options.threads > 0 ? static_cast<size_t>(options.threads) : cores;
+  WorkerPool pool(threads - 1, 1);
+  AttractorCore core(pool);
+
+  // Raw frames go to stdout or a file back to back, images to one file each
+  bool raw = options.output == "-" || endsWith(options.output, ".rgba");
+  using FilePtr = std::unique_ptr<FILE, int (*)(FILE*)>;
+  FilePtr stream(nullptr, &std::fclose);
+  if (raw && options.output != "-") {
+    stream.reset(std::fopen(options.output.c_str(), "wb"));
+    if (!stream) {
+      throw std::runtime_error("Cannot open " + options.output);
+    }
+  }
+  FILE* rawOut = stream ? stream.get() : stdout;
+  size_t pixels = static_cast<size_t>(options.width) * options.height;
+
+  auto start = std::chrono::steady_clock::now();
+  renderAnimation(core, pool, animation, [&](int frame, const uint32_t* image) {
+    if (!raw) {
+      writeImage(framePath(options.output, frame), image, options.width, options.height);
+    } else if (std::fwrite(image, sizeof(uint32_t), pixels, rawOut) != pixels) {
+      throw std::runtime_error("Failed to write frame " + std::to_string(frame));
+    }
+  });
+  double elapsedMs = millisecondsSince(start);
+  if (std::fflush(rawOut) != 0) {
+    throw std::runtime_error("Failed to write " + options.output);
+  }
+
+  // stdout may carry the frames, so the summary goes to stderr
+  std::fprintf(stderr, "frames       %d (%dx%d)\n", options.frames, options.width, options.height);
+  std::fprintf(stderr, "points       %lld per frame\n", static_cast<long long>(options.points));
+  std::fprintf(stderr, "threads      %d\n", pool.concurrency());
+  std::fprintf(
+    stderr,
+    "total        %.1f ms (%.2f frames/s)\n",
+    elapsedMs,
+    options.frames / std::max(elapsedMs, 1e-3) * 1000.0
+  );
+  return 0;
+}
+
+int
+render(CliOptions options) {
+  if (options.frames > 0) {
+    return renderFrames(options);
+  }
+
+  // Bands replay the orbit, which only gives the same points with a seed
+  if (options.bandRows > 0 && !options.params.seed) {
+    std::random_device seeder;
+    options.params.seed = (static_cast<uint64_t>(seeder()) << 32) | seeder();
+  }
+  // Fails early on an unknown attractor
+  AttractorCore::getAttractorType(options.params.attractor);
+
+  // Same split as the app: the calling thread takes part, so one helper less than the cores
+  size_t cores = std::max(1u, std::thread::hardware_concurrency());
+  size_t threads = options.threads > 0 ? static_cast<size_t>(options.threads) : cores;
+  WorkerPool pool(threads - 1, 1);
+  AttractorCore core(pool);
+
+  RenderStats stats =
+    options.bandRows > 0 ? renderBands(core, options) : renderWhole(core, options);
+
+  const AttractorParameters& params = options.params;
+  SimdLevel simdLevel = options.useSimd && !params.seed ? detectSimdLevel() : SimdLevel::SCALAR;
+  int64_t pointsPlotted = stats.points * stats.bands;
+  std::printf("output       %s (%dx%d)\n", options.output.c_str(), options.width, options.height);
+  std::printf("points       %lld\n", static_cast<long long>(stats.points));
+  if (options.converge > 0) {
+    std::printf("converged    %s\n", stats.converged ? "yes" : "no, ran the whole budget");
+  }
+  if (params.seed) {
+    std::printf("seed         %llu\n", static_cast<unsigned long long>(*params.seed));
+  }
+  if (options.bandRows > 0) {
+    std::printf("bands        %d of %d rows\n", stats.bands, stats.bandRows);
+  }
+  std::printf("threads      %d (%s)\n", stats.threadCount, simdLevelName(simdLevel));
+  std::printf("precision    %s\n", trigPrecisionName(params.precision));
+  std::printf(
+    "layout       %s%s\n",
+    options.layout == DensityLayout::TILED ? "tiled" : "row-major",
+    options.compact ? ", compact" : ""
+  );
+  std::printf("max density  %d\n", stats.maxDensity);
+  std::printf("density      %.1f MB\n", stats.densityBytes / 1048576.0);
+  if (stats.tiles > 0) {
+    std::printf(
+      "occupied     %zu of %zu tiles (%.0f%%)\n",
+      stats.occupiedTiles,
+      stats.tiles,
+      100.0 * stats.occupiedTiles / stats.tiles
+    );
+  }
+  std::printf(
+    "accumulate   %.1f ms (%.1f Mpoints/s)\n",
+    stats.accumulateMs,
+    pointsPlotted / std::max(stats.accumulateMs, 1e-3) / 1000.0
+  );
+  std::printf("colour       %.1f ms\n", stats.colorMs);
+  std::printf("write        %.1f ms\n", stats.writeMs);
+  return 0;
+}
+
+}  // namespace
+
+int
+main(int argc, char** argv) {
+  try {
+    return render(parseArguments(argc, argv));
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "attractor-cli: %s\n", e.what());
+    return 1;
+  }
+}
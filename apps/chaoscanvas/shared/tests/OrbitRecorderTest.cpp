@@ -0,0 +1,146 @@
+// Checks OrbitRecorder: that a ring asked for fewer points than its orbits take at once
+// still gets a few blocks per orbit, and that the points of a seeded render re-binned at
+// another left/top match that render accumulated there directly, up to the pixels the
+// 16-bit quantization moves a point to. Exits non-zero on a failure, ctest runs it.
+
+#include "../AttractorCore.h"
+#include "../OrbitRecorder.h"
+#include "../WorkerPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace facebook::react;
+
+namespace {
+
+int failures = 0;
+
+void
+check(bool ok, const std::string& what) {
+  std::printf("%s %s\n", ok ? "ok  " : "FAIL", what.c_str());
+  if (!ok) {
+    failures++;
+  }
+}
+
+const int kWidth = 320;
+const int kHeight = 240;
+const int kPoints = 4000000;
+
+AttractorParameters
+parameters(const std::string& attractor, double left, double top) {
+  return {
+    .attractor = attractor,
+    .a = attractor == "clifford" ? 2.0 : -2.0,
+    .b = -2.0,
+    .c = attractor == "clifford" ? 1.0 : -1.2,
+    .d = attractor == "clifford" ? -1.0 : 2.0,
+    .hue = 333,
+    .saturation = 100,
+    .brightness = 100,
+    .background = {0, 0, 0, 255},
+    .scale = 60,
+    .left = left,
+    .top = top,
+    .seed = 3,
+  };
+}
+
+// Density of a seeded render at params, recording its orbit when recorder isn't null
+std::vector<uint32_t>
+accumulate(AttractorCore& core, const AttractorParameters& params, OrbitRecorder* recorder) {
+  std::vector<uint32_t> density(static_cast<size_t>(kWidth) * kHeight, 0);
+  int maxDensity = 0;
+  double x = 0;
+  double y = 0;
+  AccumulationContext context = {
+    .densityPtr = density.data(),
+    .densitySize = density.size(),
+    .maxDensity = maxDensity,
+    .x = x,
+    .y = y,
+    .pointsToCalculate = kPoints,
+    .w = kWidth,
+    .h = kHeight,
+    .attractorParams = params,
+    .centerX = AttractorCore::centerX(params, kWidth),
+    .centerY = AttractorCore::centerY(params, kHeight),
+    .attractorType = AttractorCore::getAttractorType(params.attractor),
+    .recorder = recorder,
+  };
+  core.accumulateDensityParallel(context, 4, false);
+  return density;
+}
+
+}  // namespace
+
+int
+main() {
+  char line[128];
+
+  AttractorParameters base = parameters("clifford", 0, 0);
+  OrbitRecorder small(10000, 8, base);
+  std::snprintf(line, sizeof(line), "10000 points on 8 orbits keep %zu slots", small.capacity());
+  size_t minCapacity = 8 * OrbitRecorder::kMinBlocksPerOrbit * OrbitRecorder::kBlockSize;
+  check(small.capacity() >= minCapacity, line);
+
+  WorkerPool pool(3, 1);
+  AttractorCore core(pool);
+  for (const std::string attractor : {"clifford", "dejong"}) {
+    AttractorParameters recorded = parameters(attractor, 0, 0);
+    // Room for every point, the blocks the orbits leave partly empty included, so the
+    // ring doesn't wrap
+    OrbitRecorder recorder(2 * kPoints, pool.concurrency(), recorded);
+    accumulate(core, recorded, &recorder);
+
+    for (auto [left, top] : {std::pair{0.13, -0.08}, std::pair{-0.21, 0.17}}) {
+      AttractorParameters moved = parameters(attractor, left, top);
+      std::vector<uint32_t> expected = accumulate(core, moved, nullptr);
+      std::vector<uint32_t> rebinned(expected.size(), 0);
+      int64_t plotted = 0;
+      recorder.rebin(
+        rebinned.data(),
+        nullptr,
+        nullptr,
+        DensityLayout::ROW_MAJOR,
+        kWidth,
+        kHeight,
+        AttractorCore::centerX(moved, kWidth),
+        AttractorCore::centerY(moved, kHeight),
+        plotted,
+        &pool
+      );
+
+      // A level is a few thousandths of a pixel, so only points within that of a pixel
+      // edge change pixel: the totals agree to a thousandth, and under 2% of the points
+      // land in another pixel
+      int64_t total = 0;
+      int64_t difference = 0;
+      for (size_t i = 0; i < expected.size(); i++) {
+        total += expected[i];
+        difference += std::abs(static_cast<int64_t>(expected[i]) - rebinned[i]);
+      }
+      double lost = std::abs(static_cast<double>(plotted - total)) / std::max<int64_t>(1, total);
+      double changed = static_cast<double>(difference) / std::max<int64_t>(1, total);
+      std::snprintf(
+        line,
+        sizeof(line),
+        "%s re-binned at %g, %g: %lld points, %.3g%% in another pixel",
+        attractor.c_str(),
+        left,
+        top,
+        static_cast<long long>(plotted),
+        100 * changed
+      );
+      check(total > kPoints / 10 && lost < 1e-3 && changed < 0.02, line);
+    }
+  }
+
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
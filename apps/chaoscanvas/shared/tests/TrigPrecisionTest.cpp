@@ -0,0 +1,160 @@
+// Checks the sin/cos precision tiers of FastTrig.h: the max error of each tier against
+// the bound it documents, and that each tier renders the same density as the exact one,
+// up to the difference two seeds of the exact tier already show. Exits non-zero on a
+// failure, ctest runs it.
+
+#include "../AttractorCore.h"
+#include "../FastTrig.h"
+#include "../WorkerPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace facebook::react;
+
+namespace {
+
+int failures = 0;
+
+void
+check(bool ok, const std::string& what) {
+  std::printf("%s %s\n", ok ? "ok  " : "FAIL", what.c_str());
+  if (!ok) {
+    failures++;
+  }
+}
+
+// Max error of the tier's sin and cos over |x| < 64, the arguments the maps see
+template <TrigPrecision precision>
+double
+maxTrigError() {
+  const int samples = 4000000;
+  double maxError = 0;
+  for (int i = 0; i <= samples; i++) {
+    double x = -64.0 + 128.0 * i / samples;
+    maxError = std::max(maxError, std::abs(trigSin<precision>(x) - std::sin(x)));
+    maxError = std::max(maxError, std::abs(trigCos<precision>(x) - std::cos(x)));
+  }
+  return maxError;
+}
+
+const int kWidth = 256;
+const int kHeight = 256;
+const int kPoints = 8000000;
+
+// Normalized density of a render, the seeded ones run the scalar kernel and the unseeded
+// ones the SIMD kernel when the CPU has one
+std::vector<double>
+renderHistogram(
+  AttractorCore& core,
+  const std::string& attractor,
+  TrigPrecision precision,
+  std::optional<uint64_t> seed
+) {
+  AttractorParameters params = {
+    .attractor = attractor,
+    .a = attractor == "clifford" ? 2.0 : -2.0,
+    .b = attractor == "clifford" ? -2.0 : -2.0,
+    .c = attractor == "clifford" ? 1.0 : -1.2,
+    .d = attractor == "clifford" ? -1.0 : 2.0,
+    .hue = 333,
+    .saturation = 100,
+    .brightness = 100,
+    .background = {0, 0, 0, 255},
+    .scale = 50,
+    .left = 0,
+    .top = 0,
+    .seed = seed,
+    .precision = precision,
+  };
+  std::vector<uint32_t> density(static_cast<size_t>(kWidth) * kHeight, 0);
+  int maxDensity = 0;
+  double x = 0;
+  double y = 0;
+  AccumulationContext context = {
+    .densityPtr = density.data(),
+    .densitySize = density.size(),
+    .maxDensity = maxDensity,
+    .x = x,
+    .y = y,
+    .pointsToCalculate = kPoints,
+    .w = kWidth,
+    .h = kHeight,
+    .attractorParams = params,
+    .centerX = kWidth / 2.0,
+    .centerY = kHeight / 2.0,
+    .attractorType = AttractorCore::getAttractorType(attractor),
+  };
+  core.accumulateDensityParallel(context, 1, true);
+
+  double total = 0;
+  for (uint32_t value : density) {
+    total += value;
+  }
+  std::vector<double> histogram(density.size());
+  for (size_t i = 0; i < density.size(); i++) {
+    histogram[i] = density[i] / total;
+  }
+  return histogram;
+}
+
+// Sum of the absolute differences, 0 for the same density and 2 for disjoint ones
+double
+distance(const std::vector<double>& a, const std::vector<double>& b) {
+  double sum = 0;
+  for (size_t i = 0; i < a.size(); i++) {
+    sum += std::abs(a[i] - b[i]);
+  }
+  return sum;
+}
+
+}  // namespace
+
+int
+main() {
+  char line[128];
+
+  double exactError = maxTrigError<TrigPrecision::EXACT>();
+  double floatError = maxTrigError<TrigPrecision::FLOAT>();
+  double fastError = maxTrigError<TrigPrecision::FAST>();
+  std::snprintf(line, sizeof(line), "exact max error %.3g <= 0", exactError);
+  check(exactError == 0, line);
+  std::snprintf(line, sizeof(line), "float max error %.3g <= 2e-6", floatError);
+  check(floatError <= 2e-6, line);
+  std::snprintf(line, sizeof(line), "fast max error %.3g <= 1.3e-5", fastError);
+  check(fastError <= 1.3e-5, line);
+
+  WorkerPool pool(0, 1);
+  AttractorCore core(pool);
+  const TrigPrecision tiers[] = {TrigPrecision::EXACT, TrigPrecision::FLOAT, TrigPrecision::FAST};
+  for (const std::string attractor : {"clifford", "dejong"}) {
+    std::vector<double> reference =
+      renderHistogram(core, attractor, TrigPrecision::EXACT, uint64_t{1});
+    // What another orbit of the exact map already changes, the tolerance scales with it
+    double noise =
+      distance(reference, renderHistogram(core, attractor, TrigPrecision::EXACT, uint64_t{2}));
+    double tolerance = 1.5 * noise;
+
+    for (TrigPrecision precision : tiers) {
+      double scalar = distance(reference, renderHistogram(core, attractor, precision, uint64_t{3}));
+      double simd = distance(reference, renderHistogram(core, attractor, precision, std::nullopt));
+      std::snprintf(
+        line,
+        sizeof(line),
+        "%s %s scalar %.4f, simd %.4f <= %.4f",
+        attractor.c_str(),
+        trigPrecisionName(precision),
+        scalar,
+        simd,
+        tolerance
+      );
+      check(scalar <= tolerance && simd <= tolerance, line);
+    }
+  }
+
+  return failures == 0 ? 0 : 1;
+}
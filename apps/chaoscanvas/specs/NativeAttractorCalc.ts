@@ -3,6 +3,10 @@ import { TurboModule, TurboModuleRegistry } from 'react-native';
 export interface Spec extends TurboModule {
   readonly getBuildNumber: () => string;
   readonly ratePerformance: () => number;
+  // calculation jobs waiting behind the running one
+  readonly getQueueDepth: () => number;
+  // stops the running and queued calculations of a timestamp, their promises reject
+  readonly cancelCalculation: (timestamp: string) => void;
   readonly calculateAttractor: (
     // timestamp: ISO string, used to identify the calculation
     timestamp: string,
@@ -12,6 +16,8 @@ export interface Spec extends TurboModule {
     imageBuffer: Object,
     highQuality: boolean,
 
+    // seed (optional): same parameters, seed and x/y give the same density on any thread count
+    // precision (optional): sin/cos accuracy, "exact" (default), "float" or "fast"
     attractorParameters: Object,
     width: number,
     height: number,
@@ -21,12 +27,75 @@ export interface Spec extends TurboModule {
 
     // how many points to calculate
     pointsToCalculate: number,
+
+    // optional settings
+    // threadCount: worker threads for accumulation, 0 uses all cores
+    // useSimd: multi-orbit SIMD kernel when the CPU has one (default true)
+    // onProgress: called with { timestamp, progress, pointsAdded, maxDensity, frame }
+    //   while the calculation runs, progress is 0-1 of this call's points
+    // progressInterval: ms between two onProgress calls (default 100)
+    // partialFrames: redraw the image buffer before each onProgress call (frame: true)
+    // coarsePreview: colour frames from a 1/2 to 1/8 size copy of the density until it
+    //   holds about a point per pixel (default true). Needs pointsBefore, or a call
+    //   that starts with maxDensity 0.
+    // pointsBefore: points already in the density from earlier calls of the render
+    // renderPoints: points of the whole render, so the frame at the end of a call
+    //   before the last one is coarse too (default 0, always full resolution)
+    // chunkBudgetMs: run the points in chunks sized to this many ms and send a whole
+    //   frame to onProgress at targetFps between them, instead of progressInterval
+    //   updates (default 0, off). Chunk sizes follow the device's speed, so a seeded
+    //   render is only reproducible without it.
+    // targetFps: frames per second sent while chunkBudgetMs is set (default 30)
+    // convergenceThreshold: with chunkBudgetMs, stop early once doubling the points
+    //   changes the image by less than this, e.g. 0.004 (default 0, off)
+    // recordOrbit: keep the newest recordOrbit points (4 bytes each) for rebinAttractor,
+    //   at least 16384 per core (default 0, off)
+    options?: Object,
   ) => Promise<{
     timestamp: string;
     x: number;
     y: number;
     maxDensity: number;
     pointsAdded: number;
+    // the job stopped before its points were done, see convergenceThreshold
+    converged?: boolean;
+  }>;
+  // redraws the points kept with recordOrbit for a new left/top or canvas size without
+  // iterating the map; resolves null when none were kept for this map, a-d and scale,
+  // then calculateAttractor has to run
+  readonly rebinAttractor: (
+    timestamp: string,
+    densityBuffer: Object,
+    imageBuffer: Object,
+    highQuality: boolean,
+    attractorParameters: Object,
+    width: number,
+    height: number,
+  ) => Promise<{
+    timestamp: string;
+    maxDensity: number;
+    pointsAdded: number;
+  } | null>;
+  // renders an animation of frameCount frames, the parameters interpolated between the
+  // keyframes ({ frame, attractorParameters }), and writes it to outputPath as raw RGBA
+  // frames back to back; frames render in parallel, one per core. Animations run on a
+  // worker pool of their own, so calculateAttractor and rebinAttractor calls made
+  // meanwhile are not queued behind them; cancelCalculation(timestamp) stops one
+  readonly renderAnimation: (
+    timestamp: string,
+    keyframes: Object[],
+    frameCount: number,
+    width: number,
+    height: number,
+    pointsPerFrame: number,
+    highQuality: boolean,
+    outputPath: string,
+    // onFrame: called with { timestamp, frame, framesDone } as each frame is written
+    // useSimd: multi-orbit SIMD kernel when the CPU has one (default true)
+    options?: Object,
+  ) => Promise<{
+    timestamp: string;
+    frames: number;
   }>;
 }
 
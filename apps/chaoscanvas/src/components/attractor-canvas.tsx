@@ -300,8 +300,8 @@ function useIterativeAttractorImage(
       const hQualityVal = hQuality.get();
 
       const fn = attractor === 'clifford' ? clifford : dejong;
-      const cx = wVal / 2 + left;
-      const cy = hVal / 2 + top;
+      const cx = wVal / 2 + left * wVal;
+      const cy = hVal / 2 + top * hVal;
       const s = scale * SCALE;
       const drawAt = 20;
 
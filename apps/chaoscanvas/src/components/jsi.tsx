@@ -142,6 +142,7 @@ export function Jsi() {
       width: Math.round(width),
       height: Math.round(height),
       highQuality: true,
+      progressInterval: 250,
       log: false,
       onProgress: (totalProgress, totalPoints, totalAttractorPoints) => {
         setProgress(totalProgress);
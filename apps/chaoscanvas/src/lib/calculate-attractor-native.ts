@@ -67,6 +67,25 @@ export type AttractorCalcModuleParams = {
   height?: number;
   highQuality?: boolean;
 
+  // worker threads for accumulation, 0 uses all cores
+  threadCount?: number;
+
+  // ms between progress and image updates while a chunk runs, 0 updates per chunk only
+  progressInterval?: number;
+
+  // wall-clock budget per native chunk in ms; when set the whole render is one call and
+  // the native side sizes its chunks to the device, redrawing at targetFps
+  chunkBudgetMs?: number;
+  targetFps?: number;
+  // with chunkBudgetMs, stop once doubling the points no longer changes the image
+  // by this much (mean log-density change relative to the max, 0.004 is about one
+  // colour step); 0 runs the whole budget
+  convergenceThreshold?: number;
+
+  // points of the orbit kept natively (4 bytes each) so rebin() can redraw a pan
+  // without recomputing; 0 keeps none
+  recordOrbit?: number;
+
   onProgress?: (
     totalProgress: number,
     totalPoints: number,
@@ -81,6 +100,10 @@ export function getBuildNumber() {
   return NativeAttractorCalc.getBuildNumber();
 }
 
+export function getQueueDepth() {
+  return NativeAttractorCalc.getQueueDepth();
+}
+
 const SCALE = 150;
 export function calculateAttractorNative(params: AttractorCalcModuleParams) {
   let {
@@ -94,6 +117,12 @@ export function calculateAttractorNative(params: AttractorCalcModuleParams) {
     height = 1000,
 
     highQuality = true,
+    threadCount = 0,
+    progressInterval = 0,
+    chunkBudgetMs = 0,
+    targetFps = 30,
+    convergenceThreshold = 0,
+    recordOrbit = 0,
     onProgress,
     onImageUpdate,
 
@@ -109,9 +138,8 @@ export function calculateAttractorNative(params: AttractorCalcModuleParams) {
   const dataView = new Uint32Array(width * height); // RGBA format
   const densityView = new Uint32Array(width * height); // uint32 format
 
-  // Initialize arrays with zeros
-  dataView.fill(0);
-  densityView.fill(0);
+  // New typed arrays start zeroed, no need to fill them. A rebin() clears only the
+  // tiles the native side wrote.
 
   // Create the ArrayBuffer that will be written to by the C++ code.
   const sharedDensityBuffer = densityView.buffer; // uint32
@@ -137,19 +165,22 @@ export function calculateAttractorNative(params: AttractorCalcModuleParams) {
   function cancelFunction() {
     if (log) console.log('assigning cancel function');
     cancelled = true;
+    // stop the chunk that is running now, not just the ones after it
+    NativeAttractorCalc.cancelCalculation(timestamp);
   }
 
   // something to measure the time it takes to run the calculation
   const now = new Date().getTime();
 
-  const onProgressLocal = (pointsAdded: number) => {
+  const onProgressLocal = (pointsAdded: number, converged = false) => {
     if (cancelled) {
       if (log) console.log('Calculation cancelled, skipping progress update');
       return;
     }
 
     totalPoints += pointsAdded;
-    totalProgress = totalPoints / totalAttractorPoints;
+    // a converged render is done, however many points it skipped
+    totalProgress = converged ? 1 : totalPoints / totalAttractorPoints;
 
     if (log)
       console.log(
@@ -188,6 +219,47 @@ export function calculateAttractorNative(params: AttractorCalcModuleParams) {
     ...attractorParameters,
     scale: attractorParameters.scale * SCALE,
   };
+  // progress within the running chunk, streamed by the native module
+  const onChunkProgress = (event: {
+    pointsAdded: number;
+    frame: boolean;
+  }) => {
+    if (cancelled) return;
+    const points = totalPoints + event.pointsAdded;
+    onProgress &&
+      onProgress(
+        points / totalAttractorPoints,
+        points,
+        totalAttractorPoints,
+      );
+    if (event.frame) onImageUpdateLocal();
+  };
+  const options =
+    chunkBudgetMs > 0
+      ? {
+          threadCount,
+          chunkBudgetMs,
+          targetFps,
+          convergenceThreshold,
+          onProgress: onChunkProgress,
+        }
+      : progressInterval > 0
+      ? {
+          threadCount,
+          progressInterval,
+          partialFrames: !!onImageUpdate,
+          onProgress: onChunkProgress,
+        }
+      : { threadCount };
+
+  const calculationOptions =
+    recordOrbit > 0 ? { ...options, recordOrbit } : options;
+
+  // The native scheduler sizes the chunks itself, so the render is a single call
+  if (chunkBudgetMs > 0) {
+    pointsPerIteration = totalAttractorPoints;
+  }
+
   while (tp < totalAttractorPoints) {
     returnedPromise = returnedPromise.then(async () => {
       // on canccellation
@@ -201,6 +273,7 @@ export function calculateAttractorNative(params: AttractorCalcModuleParams) {
         y: newY,
         maxDensity: newMaxDensity,
         pointsAdded,
+        converged,
       } = await NativeAttractorCalc.calculateAttractor(
         timestamp,
         sharedDensityBuffer,
@@ -215,14 +288,21 @@ export function calculateAttractorNative(params: AttractorCalcModuleParams) {
         maxDensity,
 
         pointsPerIteration,
+        // the density's point count sizes the coarse preview frames
+        {
+          ...calculationOptions,
+          pointsBefore: totalPoints,
+          renderPoints: totalAttractorPoints,
+        },
       );
 
       x = newX;
       y = newY;
       maxDensity = newMaxDensity;
 
-      onProgressLocal(pointsAdded);
+      onProgressLocal(pointsAdded, converged);
       onImageUpdateLocal();
+      if (log && converged) console.log('Converged after', totalPoints, 'points');
 
       return newTimestamp;
     });
@@ -241,10 +321,91 @@ export function calculateAttractorNative(params: AttractorCalcModuleParams) {
     });
   }
 
+  // Redraws the recorded orbit into the same buffers for another left/top, resolves
+  // false when it can't (nothing recorded, or another map, a-d or scale)
+  async function rebin(newAttractorParameters: AttractorParameters) {
+    if (recordOrbit <= 0) return false;
+    cancelFunction();
+    const result = await NativeAttractorCalc.rebinAttractor(
+      new Date().toISOString(),
+      sharedDensityBuffer,
+      sharedImageBuffer,
+      highQuality,
+      {
+        ...newAttractorParameters,
+        scale: newAttractorParameters.scale * SCALE,
+      },
+      width,
+      height,
+    );
+    if (!result) return false;
+    maxDensity = result.maxDensity;
+    onImageUpdate && onImageUpdate();
+    return true;
+  }
+
   // Pass the dataView to the native function.
   return {
     promise: returnedPromise,
     cancel: cancelFunction,
     imageView,
+    rebin,
+  };
+}
+
+export type AnimationKeyframe = {
+  frame: number;
+  attractorParameters: AttractorParameters;
+};
+
+// Renders an animation to outputPath as raw RGBA frames of width x height, e.g. for
+// ffmpeg -f rawvideo -pix_fmt rgba -s WxH -i outputPath. Resolves with the frame count,
+// rejects when cancel() runs first.
+export function renderAnimationNative({
+  keyframes,
+  frameCount,
+  width,
+  height,
+  pointsPerFrame,
+  outputPath,
+  highQuality = true,
+  onFrame,
+}: {
+  keyframes: AnimationKeyframe[];
+  frameCount: number;
+  width: number;
+  height: number;
+  pointsPerFrame: number;
+  outputPath: string;
+  highQuality?: boolean;
+  onFrame?: (frame: number, framesDone: number) => void;
+}) {
+  const timestamp = new Date().toISOString();
+  const promise = NativeAttractorCalc.renderAnimation(
+    timestamp,
+    keyframes.map(keyframe => ({
+      frame: keyframe.frame,
+      attractorParameters: {
+        ...keyframe.attractorParameters,
+        scale: keyframe.attractorParameters.scale * SCALE,
+      },
+    })),
+    frameCount,
+    width,
+    height,
+    pointsPerFrame,
+    highQuality,
+    outputPath,
+    {
+      onFrame: onFrame
+        ? (event: { frame: number; framesDone: number }) =>
+            onFrame(event.frame, event.framesDone)
+        : undefined,
+    },
+  ).then(result => result.frames);
+
+  return {
+    promise,
+    cancel: () => NativeAttractorCalc.cancelCalculation(timestamp),
   };
 }
@@ -5,11 +5,18 @@ import { useUIStore } from "@/store/ui-store";
 import { useAttractorStore } from "@repo/state/attractor-store";
 
 import {
+  CHUNK_BUDGET_MS,
+  COMPACT_DENSITY_MAX_MEMORY_GB,
+  CONVERGENCE_THRESHOLD,
   DEFAULT_POINTS,
   DEFAULT_SCALE,
   LOW_QUALITY_POINTS,
+  TARGET_FPS,
 } from "@/lib/constants";
 
+// uint32 slots per control block of the WASM module
+const CONTROL_BLOCK_SLOTS = 6;
+
 export function WasmLoopCanvas({ ariaLabel }: { ariaLabel?: string }) {
   const canvasSize = useUIStore((s) => s.canvasSize);
   const qualityMode = useUIStore((s) => s.qualityMode);
@@ -22,7 +29,11 @@ export function WasmLoopCanvas({ ariaLabel }: { ariaLabel?: string }) {
   const workerCalcRef = useRef<Worker | null>(null);
   const workerDrawRef = useRef<Worker | null>(null);
   const attractorParameters = useAttractorStore((s) => s.attractorParameters);
-  const infoBufferRef = useRef<SharedArrayBuffer | null>(null);
+  // uint32 view: maxDensity, cancel, done, progress (0-100), generation, converged
+  const infoRef = useRef<Uint32Array | null>(null);
+  // control blocks in the WASM module's shared memory, one is taken per render
+  const controlBlocksRef = useRef<Uint32Array | null>(null);
+  const generationRef = useRef(0);
 
   useEffect(() => {
     if (!ready) return;
@@ -40,7 +51,25 @@ export function WasmLoopCanvas({ ariaLabel }: { ariaLabel?: string }) {
     const imageBuffer = new SharedArrayBuffer(
       canvasSize?.width * canvasSize?.height * 4,
     );
-    infoBufferRef.current = new SharedArrayBuffer(4 * 4); // uint32: maxDensity, cancel, done, progress (0-100)
+
+    // Cycle through the module's control blocks so the kernel sees a cancel while it
+    // runs. Without shared WASM memory, fall back to a buffer checked between chunks.
+    const generation = ++generationRef.current;
+    const controlBlocks = controlBlocksRef.current;
+    let info: Uint32Array;
+    let controlSlot: number | undefined;
+    if (controlBlocks && controlBlocks.buffer instanceof SharedArrayBuffer) {
+      controlSlot = generation % (controlBlocks.length / CONTROL_BLOCK_SLOTS);
+      info = controlBlocks.subarray(
+        controlSlot * CONTROL_BLOCK_SLOTS,
+        (controlSlot + 1) * CONTROL_BLOCK_SLOTS,
+      );
+      for (let i = 0; i < 4; i++) Atomics.store(info, i, 0);
+      Atomics.store(info, 4, generation);
+    } else {
+      info = new Uint32Array(new SharedArrayBuffer(4 * 4));
+    }
+    infoRef.current = info;
 
     const data = {
       ...attractorParameters,
@@ -51,7 +80,20 @@ export function WasmLoopCanvas({ ariaLabel }: { ariaLabel?: string }) {
       iterations: qualityMode === "low" ? LOW_QUALITY_POINTS : DEFAULT_POINTS,
       densityBuffer,
       imageBuffer,
-      infoBuffer: infoBufferRef.current,
+      infoBuffer: info.buffer,
+      infoOffset: info.byteOffset,
+      controlSlot,
+      generation,
+      // chunks sized to the measured speed, redrawn at a steady rate on any device
+      chunkBudgetMs: CHUNK_BUDGET_MS,
+      targetFps: TARGET_FPS,
+      // stops early once doubling the points would change the image by less than this
+      convergenceThreshold: CONVERGENCE_THRESHOLD,
+      // 16-bit density counters on low-memory devices, deviceMemory is only
+      // reported by Chromium
+      compact:
+        ((navigator as { deviceMemory?: number }).deviceMemory ?? Infinity) <=
+        COMPACT_DENSITY_MAX_MEMORY_GB,
     };
 
     workerCalcRef.current?.postMessage({
@@ -66,10 +108,7 @@ export function WasmLoopCanvas({ ariaLabel }: { ariaLabel?: string }) {
 
     return () => {
       // cancel all operation
-      if (infoBufferRef.current) {
-        const uint32 = new Uint32Array(infoBufferRef.current);
-        uint32[1] = 1;
-      }
+      Atomics.store(info, 1, 1);
     };
     // eslint-disable-next-line react-hooks/exhaustive-deps
   }, [init, ready, attractorParameters, qualityMode, canvasSize]);
@@ -125,6 +164,7 @@ export function WasmLoopCanvas({ ariaLabel }: { ariaLabel?: string }) {
         }
       }
       if (e.data.type === "initialized") {
+        controlBlocksRef.current = e.data.controlBlocks ?? null;
         initializedState++;
         if (initializedState === 2) {
           onBothInitialized();
@@ -172,9 +212,8 @@ export function WasmLoopCanvas({ ariaLabel }: { ariaLabel?: string }) {
   useEffect(() => {
     return () => {
       // cancel all operation
-      if (infoBufferRef.current) {
-        const uint32 = new Uint32Array(infoBufferRef.current);
-        uint32[1] = 1;
+      if (infoRef.current) {
+        Atomics.store(infoRef.current, 1, 1);
       }
       workerDrawRef.current?.terminate();
       workerCalcRef.current?.terminate();
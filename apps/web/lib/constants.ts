@@ -3,3 +3,12 @@ export const DEFAULT_POINTS = 50_000_000;
 export const DEFAULT_SCALE = 150;
 export const LOW_QUALITY_POINTS = 200_000;
 export const LOW_QUALITY_INTERVAL = 5;
+// Wall-clock budget per chunk of points and redraw rate of the WASM loop
+export const CHUNK_BUDGET_MS = 12;
+export const TARGET_FPS = 30;
+// Mean change in log density, relative to the max, under which doubling the points no
+// longer shows: about one colour step out of 255
+export const CONVERGENCE_THRESHOLD = 0.004;
+// Devices reporting this much memory or less (navigator.deviceMemory, in GB) keep the
+// WASM density in 16-bit counters, half the memory of 32-bit ones
+export const COMPACT_DENSITY_MAX_MEMORY_GB = 2;
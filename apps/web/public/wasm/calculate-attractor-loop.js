@@ -357,6 +357,7 @@ function calculateAttractorLoop(jsCtx) {
       attractorParams,
       // densityBuffer,
       infoBuffer,
+      infoOffset = 0,
       imageBuffer,
       highQuality,
       pointsToCalculate,
@@ -370,7 +371,7 @@ function calculateAttractorLoop(jsCtx) {
 
     // Create typed array views
     const imageArray = new Uint32Array(imageBuffer);
-    const infoArray = new Uint32Array(infoBuffer);
+    const infoArray = new Uint32Array(infoBuffer, infoOffset, 4);
 
     // Create local arrays for fast computation
     const uint32DensityArray = new Uint32Array(width * height);
@@ -16,7 +16,11 @@ self.onmessage = async function (e) {
         // Load the WebAssembly module
         if (!wasmModule) {
           wasmModule = await AttractorModule();
-          self.postMessage({ type: "initialized" });
+          // Control blocks live in the module's shared memory, the page takes one per render
+          self.postMessage({
+            type: "initialized",
+            controlBlocks: wasmModule.getControlBlocks(),
+          });
         }
       } catch (error) {
         console.error(error);
@@ -76,6 +80,7 @@ async function performLowQualityCalculation(data) {
       densityBuffer = new SharedArrayBuffer(width * height * 4),
       imageBuffer = new SharedArrayBuffer(width * height * 4),
       infoBuffer = new SharedArrayBuffer(4 * 4), // uint32: maxDensity, cancel, done, progress (0-100)
+      infoOffset = 0,
     } = data;
 
     // Call the JavaScript function
@@ -114,6 +119,7 @@ async function performLowQualityCalculation(data) {
       attractorParams,
       densityBuffer,
       infoBuffer,
+      infoOffset,
       imageBuffer,
       highQuality,
       pointsToCalculate,
@@ -130,7 +136,7 @@ async function performLowQualityCalculation(data) {
       throw new Error(result.error);
     }
 
-    const info = new Uint32Array(infoBuffer);
+    const info = new Uint32Array(infoBuffer, infoOffset, 4);
     // if(!canceled)
     if (!info[1]) {
       console.log("JS calc done in", performance.now() - start, "ms");
@@ -174,6 +180,13 @@ async function performAttractorLoopCalculation(data) {
       densityBuffer = new SharedArrayBuffer(width * height * 4),
       imageBuffer = new SharedArrayBuffer(width * height * 4),
       infoBuffer = new SharedArrayBuffer(4 * 4), // uint32: maxDensity, cancel, done, progress (0-100)
+      infoOffset = 0,
+      controlSlot, // block of getControlBlocks() the info view points at, if any
+      generation,
+      chunkBudgetMs = 0, // > 0 sizes chunks by measured speed instead of loopNum
+      targetFps = 30,
+      convergenceThreshold = 0, // > 0 stops once more points no longer change the image
+      compact = false, // 16-bit density counters, half the memory of 32-bit ones
     } = data;
 
     // Call the WebAssembly function
@@ -219,7 +232,7 @@ async function performAttractorLoopCalculation(data) {
       pointsToCalculate,
     );
 
-    wasmModule.calculateAttractorLoop({
+    const result = wasmModule.calculateAttractorLoop({
       attractorParams,
       densityBuffer,
       infoBuffer,
@@ -232,14 +245,23 @@ async function performAttractorLoopCalculation(data) {
       y: 0,
       loopNum,
       drawAt,
+      controlSlot,
+      generation,
+      chunkBudgetMs,
+      targetFps,
+      convergenceThreshold,
+      compact,
     });
 
-    const info = new Uint32Array(infoBuffer);
+    const info = new Uint32Array(infoBuffer, infoOffset, 4);
     // if(!canceled)
-    if (!info[1]) {
+    if (!Atomics.load(info, 1)) {
       console.log("calc done in", performance.now() - start, "ms");
+      if (result.converged) {
+        console.log("converged after", result.pointsAdded, "points");
+      }
       // update the doneFlag
-      info[2] = 1;
+      Atomics.store(info, 2, 1);
     }
 
     self.postMessage({ type: "done" });
@@ -71,13 +71,14 @@ async function performAttractorDraw(data) {
       background = [0, 0, 0, 255],
       imageBuffer = new SharedArrayBuffer(width * height * 4),
       infoBuffer = new SharedArrayBuffer(4 * 4), // uint32: maxDensity, cancel, done, progress (0-100)
+      infoOffset = 0,
     } = data;
 
     // Call the WebAssembly function
     const start = performance.now();
     console.log("Starting attractor drawing with data:", data);
 
-    const info = new Uint32Array(infoBuffer);
+    const info = new Uint32Array(infoBuffer, infoOffset, 4);
     const ctx = offscreenCanvas.getContext("2d");
     ctx.clearRect(0, 0, width, height);
     const imageData = ctx.createImageData(width, height);
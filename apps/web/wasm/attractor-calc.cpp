@@ -1,249 +1,68 @@
 //------------------------------------------------------------------------------
 // WebAssembly Attractor Calculator Module
 //
-// This module implements Clifford and deJong attractors in C++ compiled to WebAssembly
-// It provides the same functionality as the React Native native module but runs in browsers
-// through WebAssembly.
+// This module runs the shared attractor core (apps/chaoscanvas/shared) in browsers through
+// WebAssembly, the same iteration and colouring the React Native module runs. It only
+// adapts the core to embind and to the control blocks the page shares with it.
 //
 // The module exposes:
 // - Calculation functions for attractors (calculateAttractor, calculateAttractorDensity)
 // - Image creation function (createAttractorImage)
 // - Performance rating function to determine device capabilities (ratePerformance)
+// - Views onto the module-owned density and image buffers (getDensityView, getImageView)
 //------------------------------------------------------------------------------
 
 #include <emscripten/bind.h>
+#include <emscripten/emscripten.h>
 #include <emscripten/val.h>
 #include <algorithm>
-#include <cmath>
-#include <functional>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <random>
 #include <string>
 #include <vector>
 
-namespace attractor {
+// Shared with the React Native module, build-attractor.sh puts its directory on the path
+#include "AttractorCore.h"
+#include "ChunkScheduler.h"
+#include "CompactDensity.h"
+#include "ConvergenceTracker.h"
+#include "DensityPyramid.h"
+#include "OccupancyMap.h"
+#include "FastTrig.h"
 
-// Represents an RGB color
-struct RGB {
-  int r, g, b;
-};
+namespace attractor {
 
-struct AttractorParameters {
-  std::string attractor;
-  double a;
-  double b;
-  double c;
-  double d;
-  double hue;
-  double saturation;
-  double brightness;
-  std::vector<int> background;
-  double scale;
-  double left;
-  double top;
-};
+using facebook::react::AccumulationContext;
+using facebook::react::AttractorCore;
+using facebook::react::AttractorParameters;
+using facebook::react::AttractorType;
+using facebook::react::CalculationMonitor;
+using facebook::react::CompactDensity;
+using facebook::react::CounterCoin;
+using facebook::react::DensityLayout;
+using facebook::react::DensityPyramid;
+using facebook::react::ImageDataCreationContext;
+using facebook::react::ImageRect;
+using facebook::react::OccupancyMap;
+using facebook::react::TrigPrecision;
 
 // Version information
 std::string version = "2.0.1";
 
-// A C++ implementation of the BezierEasing function from the original JS.
-// It returns a lambda function that calculates the easing.
-std::function<double(double)>
-bezierEasing(double p0, double p1, double p2, double p3) {
-  // Define these functions to match the JavaScript implementation exactly
-  // All captures are by value [=] to ensure they work properly when returned
-
-  // These can be static since they don't depend on the parameters
-  auto A = [](double aA1, double aA2) { return 1.0 - 3.0 * aA2 + 3.0 * aA1; };
-  auto B = [](double aA1, double aA2) { return 3.0 * aA2 - 6.0 * aA1; };
-  auto C = [](double aA1) { return 3.0 * aA1; };
-
-  // This needs to capture the A, B, C functions
-  auto calc_bezier = [=](double t, double aA1, double aA2) {
-    return ((A(aA1, aA2) * t + B(aA1, aA2)) * t + C(aA1)) * t;
-  };
-
-  // This needs to capture the A, B, C functions
-  auto get_slope = [=](double t, double aA1, double aA2) {
-    return 3.0 * A(aA1, aA2) * t * t + 2.0 * B(aA1, aA2) * t + C(aA1);
-  };
-
-  // Capture everything by value to match JS implementation exactly
-  auto get_t_for_x = [=](double aX) {
-    double aGuessT = aX;
-    for (int i = 0; i < 4; ++i) {
-      double currentSlope = get_slope(aGuessT, p0, p2);
-      if (currentSlope == 0.0) {
-        return aGuessT;
-      }
-      double currentX = calc_bezier(aGuessT, p0, p2) - aX;
-      aGuessT -= currentX / currentSlope;
-    }
-    return aGuessT;
-  };
-
-  // Return the final function with everything captured by value
-  return [=](double x) {
-    if (x <= 0.0) {
-      return 0.0;
-    }
-    if (x >= 1.0) {
-      return 1.0;
-    }
-    return calc_bezier(get_t_for_x(x), p1, p3);
-  };
-}
-
-RGB
-hsvToRgb(double h, double s, double v) {
-  // Exactly match JavaScript hsv2rgb implementation
-  // Clamp input values to valid ranges
-  h = std::max(0.0, std::min(359.0, h));
-  s = std::max(0.0, std::min(100.0, s));
-  v = std::max(0.0, std::min(100.0, v));
-
-  // Normalize s and v to 0-1 range
-  s /= 100.0;
-  v /= 100.0;
-
-  // Handle grayscale case (s === 0)
-  if (s == 0.0) {
-    int val = std::round(v * 255);
-    return {val, val, val};
-  }
-
-  // Convert hue to sector (0-5)
-  h /= 60.0;
-  int i = std::floor(h);
-  double f = h - i;
-
-  // Calculate color components
-  double p = v * (1.0 - s);
-  double q = v * (1.0 - s * f);
-  double t = v * (1.0 - s * (1 - f));
-
-  // Assign RGB based on hue sector
-  double r, g, b;
-  switch (i) {
-    case 0:
-      r = v;
-      g = t;
-      b = p;
-      break;
-    case 1:
-      r = q;
-      g = v;
-      b = p;
-      break;
-    case 2:
-      r = p;
-      g = v;
-      b = t;
-      break;
-    case 3:
-      r = p;
-      g = q;
-      b = v;
-      break;
-    case 4:
-      r = t;
-      g = p;
-      b = v;
-      break;
-    default:
-      r = v;
-      g = p;
-      b = q;
-      break;  // Handles case 5 and any overflow
-  }
-
-  // Return RGB values scaled to 0-255 range and rounded to integers
-  return {
-    static_cast<int>(std::round(r * 255)),
-    static_cast<int>(std::round(g * 255)),
-    static_cast<int>(std::round(b * 255))
-  };
-}
-
-uint32_t
-getColorData(
-  double density,
-  double maxDensity,
-  double h,
-  double s,
-  double v,
-  double progress,
-  const std::vector<int>& background
-) {
-  // Exactly match JavaScript behavior
-  if (density <= 0) {
-    return 0;
-  }
-
-  // Prevent log(1) = 0 or log of negative/zero numbers
-  if (maxDensity <= 1.0) {
-    maxDensity = 1.01;
-  }
-
-  auto saturation_bezier = bezierEasing(0.79, -0.34, 0.54, 1.18);
-  auto density_bezier = bezierEasing(0.75, 0.38, 0.24, 1.33);
-  auto opacity_bezier = bezierEasing(0.24, 0.27, 0.13, 0.89);
-
-  // Match JS exactly - first calculate log values
-  double mdens = std::log(maxDensity);
-  double pdens = std::log(density);
-
-  // Match JS hsv2rgb call exactly
-  double satFactor = std::max(0.0, std::min(1.0, saturation_bezier(pdens / mdens)));
-  RGB rgb = hsvToRgb(h, s - satFactor * s, v);
-
-  // Match JS density_alpha calculation exactly
-  double density_alpha = std::max(0.0, std::min(1.0, density_bezier(pdens / mdens)));
-
-  // Get background color components with defaults matching JS behavior
-  // In JS: (background && background[0]) || 0
-  int bgR = background.size() > 0 ? background[0] : 0;
-  int bgG = background.size() > 1 ? background[1] : 0;
-  int bgB = background.size() > 2 ? background[2] : 0;
-
-  // Blend colors based on density_alpha exactly as JS does
-  int blendedR = std::round(rgb.r * density_alpha + bgR * (1 - density_alpha));
-  int blendedG = std::round(rgb.g * density_alpha + bgG * (1 - density_alpha));
-  int blendedB = std::round(rgb.b * density_alpha + bgB * (1 - density_alpha));
-
-  // Match JS exactly: opacityBezier(progress || 1)
-  double effectiveProgress = progress <= 0 ? 1.0 : progress;
-  uint32_t alpha = static_cast<uint32_t>(std::round(opacity_bezier(effectiveProgress) * 255));
-
-  // Match JS bit-shifting pattern exactly
-  return (alpha << 24) | (static_cast<uint32_t>(blendedB) << 16) |
-    (static_cast<uint32_t>(blendedG) << 8) | static_cast<uint32_t>(blendedR);
-}
-
-uint32_t
-getLowQualityPoint(double hue, double saturation, double brightness) {
-  RGB rgb = hsvToRgb(hue, saturation, brightness);
-  return (255 << 24) | (rgb.b << 16) | (rgb.g << 8) | rgb.r;
-}
-
-double
-smoothing(double num, double scale) {
-  const double factor = 0.2;
-  // Use C++ random to match JavaScript's Math.random() < 0.5 behavior
-  return num +
-    (static_cast<double>(std::rand()) / RAND_MAX < 0.5 ? -factor : factor) * (1.0 / scale);
-}
+// A progressive frame keeps colouring with the max density of the frame before while the
+// real one stays within this factor of it. The colours then still hold for the tiles no
+// new point landed in, and only the others are recoloured. The final frame is exact.
+constexpr double kPreviewDensitySlack = 1.0625;
 
-std::pair<double, double>
-clifford(double x, double y, double a, double b, double c, double d) {
-  return {std::sin(a * y) + c * std::cos(a * x), std::sin(b * x) + d * std::cos(b * y)};
+// The core throws for any other attractor, and the module is built without exceptions
+bool
+isKnownAttractor(const std::string& attractor) {
+  return attractor == "clifford" || attractor == "dejong";
 }
 
-std::pair<double, double>
-dejong(double x, double y, double a, double b, double c, double d) {
-  return {std::sin(a * y) - std::cos(b * x), std::sin(c * x) - std::cos(d * y)};
-}
-
-// Standalone utility functions to manage attractor calculations in WASM
-
 // Get build version
 std::string
 getBuildNumber() {
@@ -260,6 +79,21 @@ extractAttractorParameters(emscripten::val jsParams) {
     background.push_back(jsBackground[i].as<int>());
   }
 
+  // Optional, JS numbers hold integer seeds up to 2^53 exactly
+  std::optional<uint64_t> seed;
+  emscripten::val jsSeed = jsParams["seed"];
+  if (jsSeed.isNumber()) {
+    seed = static_cast<uint64_t>(static_cast<int64_t>(jsSeed.as<double>()));
+  }
+
+  // Optional, an unknown name falls back to exact
+  TrigPrecision precision = TrigPrecision::EXACT;
+  emscripten::val jsPrecision = jsParams["precision"];
+  if (jsPrecision.isString()) {
+    precision = facebook::react::parseTrigPrecision(jsPrecision.as<std::string>())
+                  .value_or(TrigPrecision::EXACT);
+  }
+
   return {
     jsParams["attractor"].as<std::string>(),
     jsParams["a"].as<double>(),
@@ -272,233 +106,426 @@ extractAttractorParameters(emscripten::val jsParams) {
     background,
     jsParams["scale"].as<double>(),
     jsParams["left"].as<double>(),
-    jsParams["top"].as<double>()
+    jsParams["top"].as<double>(),
+    seed,
+    precision
   };
 }
 
-// Context for accumulating density into a typed array (WASM side)
-struct AccumulationContext {
-  emscripten::val* jsDensityArray;         // Pointer to JS Uint32Array view (nullable)
-  std::vector<uint32_t>* cppDensityArray;  // Pointer to std::vector<uint32_t> (nullable)
-  emscripten::val* jsInfoArray;            // Pointer to JS Uint32Array view (nullable)
-  std::vector<uint32_t>* cppInfoArray;     // Pointer to std::vector<uint32_t> (nullable)
-  double x;
-  double y;
-  int pointsToCalculate;
-  int w;
-  int h;
-  AttractorParameters attractorParams;
-  double centerX;
-  double centerY;
-  std::function<std::pair<double, double>(double, double, double, double, double, double)> fn;
-  bool updateProgress;
+// Control block of one render, shared with JS through the module's linear memory.
+// The first four slots keep the layout of the info array the workers already use,
+// generation tells a render apart from a newer one that reuses the block, converged is
+// set when a render stopped early because more points no longer changed the image.
+// JS reads and writes it with Atomics, the kernels with relaxed atomics.
+struct ControlBlock {
+  std::atomic<uint32_t> maxDensity{0};
+  std::atomic<uint32_t> cancel{0};
+  std::atomic<uint32_t> done{0};
+  std::atomic<uint32_t> progress{0};
+  std::atomic<uint32_t> generation{0};
+  std::atomic<uint32_t> converged{0};
 };
 
-// Accumulate density function
-void
-accumulateDensity(AccumulationContext& context) {
-  int i = 0;
-  int densitySize = context.w * context.h;
-
-  // Helper functions to access info array values
-  auto getCancelFlag = [&]() -> int {
-    if (context.jsInfoArray)
-      return (*context.jsInfoArray)[1].as<int>();
-    if (context.cppInfoArray)
-      return (*context.cppInfoArray)[1];
-    return 0;
-  };
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "JS sees the fields as plain uint32");
+static_assert(sizeof(ControlBlock) == 6 * sizeof(uint32_t), "JS reads a block as 6 uint32");
 
-  auto getMaxDensity = [&]() -> int {
-    if (context.jsInfoArray)
-      return (*context.jsInfoArray)[0].as<int>();
-    if (context.cppInfoArray)
-      return (*context.cppInfoArray)[0];
-    return 0;
-  };
+inline bool
+isCancelled(const ControlBlock& control, uint32_t generation) {
+  return control.cancel.load(std::memory_order_relaxed) != 0 ||
+    control.generation.load(std::memory_order_relaxed) != generation;
+}
 
-  auto setMaxDensity = [&](uint32_t value) {
-    if (context.jsInfoArray)
-      context.jsInfoArray->set(0, value);
-    if (context.cppInfoArray)
-      (*context.cppInfoArray)[0] = value;
-  };
+// Rectangles of the image as [{ x, y, width, height }]
+emscripten::val
+rectsToJs(const std::vector<ImageRect>& rects) {
+  emscripten::val array = emscripten::val::array();
+  for (const ImageRect& rect : rects) {
+    emscripten::val object = emscripten::val::object();
+    object.set("x", rect.x);
+    object.set("y", rect.y);
+    object.set("width", rect.width);
+    object.set("height", rect.height);
+    array.call<void>("push", object);
+  }
+  return array;
+}
 
-  auto getProgress = [&]() -> int {
-    if (context.jsInfoArray)
-      return (*context.jsInfoArray)[3].as<int>();
-    if (context.cppInfoArray)
-      return (*context.cppInfoArray)[3];
-    return 0;
-  };
+// Density and image buffers owned by the module, kept in linear memory between calls.
+// JS reads them through typed_memory_view instead of copying them element by element.
+struct FrameBuffers {
+  int width = 0;
+  int height = 0;
+  // Counters in uint32_t, or in compact when it is set, density is empty then
+  std::vector<uint32_t> density;
+  std::unique_ptr<CompactDensity> compact;
+  std::vector<uint32_t> image;
+  // Tiles of the density with a point, so clearing and colouring skip the others
+  OccupancyMap occupancy;
+  // Tiles with points added since the image was last coloured
+  OccupancyMap dirty;
+  // Coarse levels the first previews of a render are coloured from
+  DensityPyramid pyramid;
+
+  // Clears both buffers, reusing the allocation when the size and the counters are
+  // unchanged
+  void
+  reset(int newWidth, int newHeight, bool useCompact) {
+    width = newWidth;
+    height = newHeight;
+    size_t size = static_cast<size_t>(width) * height;
+    if (useCompact) {
+      std::vector<uint32_t>().swap(density);
+      compact = std::make_unique<CompactDensity>(size);
+    } else {
+      compact.reset();
+      density.assign(size, 0);
+    }
+    image.assign(size, 0);
+    occupancy = OccupancyMap(width, height);
+    dirty = OccupancyMap(width, height);
+    pyramid = DensityPyramid(width, height);
+  }
+};
 
-  auto setProgress = [&](int value) {
-    if (context.jsInfoArray)
-      context.jsInfoArray->set(3, value);
-    if (context.cppInfoArray)
-      (*context.cppInfoArray)[3] = value;
-  };
+// Progressive render that lives across calls. It owns the buffers, the orbit position,
+// the coin stream and the core with its palette, so each step adds to the density of the
+// previous ones and nothing is reallocated until the canvas is resized.
+class RenderSession {
+ public:
+  RenderSession(int width, int height) {
+    buffers_.reset(std::max(0, width), std::max(0, height), false);
+  }
 
-  while (i < context.pointsToCalculate && getCancelFlag() == 0) {
-    auto next = context.fn(
-      context.x,
-      context.y,
-      context.attractorParams.a,
-      context.attractorParams.b,
-      context.attractorParams.c,
-      context.attractorParams.d
-    );
-    context.x = smoothing(next.first, context.attractorParams.scale);
-    context.y = smoothing(next.second, context.attractorParams.scale);
-
-    double screenX = context.x * context.attractorParams.scale;
-    double screenY = context.y * context.attractorParams.scale;
-    int px = static_cast<int>(std::floor(context.centerX + screenX));
-    int py = static_cast<int>(std::floor(context.centerY + screenY));
-
-    if (px >= 0 && px < context.w && py >= 0 && py < context.h) {
-      int idx = py * context.w + px;
-      if (idx >= 0 && idx < densitySize) {
-        // Handle both JS and C++ array types
-        if (context.jsDensityArray) {
-          // Use JS array
-          int currentVal = (*context.jsDensityArray)[idx].as<int>();
-          int newVal = currentVal + 1;
-          context.jsDensityArray->set(idx, newVal);
-
-          if (newVal > getMaxDensity()) {
-            setMaxDensity(newVal);
-          }
-        } else if (context.cppDensityArray) {
-          // Use C++ vector
-          (*context.cppDensityArray)[idx]++;
-          uint32_t newVal = (*context.cppDensityArray)[idx];
-
-          if (newVal > getMaxDensity()) {
-            setMaxDensity(newVal);
-          }
-        }
-      }
+  // Starts a new render from (x, y). Returns an object with an error when the
+  // attractor type is invalid, undefined otherwise.
+  emscripten::val
+  start(const AttractorParameters& params, double x, double y) {
+    params_ = params;
+    valid_ = isKnownAttractor(params_.attractor);
+    if (!valid_) {
+      emscripten::val error = emscripten::val::object();
+      error.set(
+        "error",
+        "Invalid attractor type: " + params_.attractor + ". Must be 'clifford' or 'dejong'."
+      );
+      return error;
+    }
+    attractorType_ = AttractorCore::getAttractorType(params_.attractor);
+
+    uint64_t seed;
+    if (params_.seed) {
+      seed = *params_.seed;
+    } else {
+      std::random_device seeder;
+      seed = (static_cast<uint64_t>(seeder()) << 32) | seeder();
+    }
+    coin_ = CounterCoin(facebook::react::coinStreamKey(seed, 0, x, y));
+    x_ = x;
+    y_ = y;
+    pointsAdded_ = 0;
+    control_->done.store(0, std::memory_order_relaxed);
+    control_->progress.store(0, std::memory_order_relaxed);
+    control_->converged.store(0, std::memory_order_relaxed);
+    clear();
+    return emscripten::val::undefined();
+  }
+
+  emscripten::val
+  reset(emscripten::val jsParams) {
+    setCancelled(false);
+    return start(extractAttractorParameters(jsParams), 0, 0);
+  }
+
+  // Runs the session against a block shared with JS, or its own block when null.
+  // Work stops as soon as the block is cancelled or its generation moves past this one.
+  void
+  useControlBlock(ControlBlock* control, uint32_t generation) {
+    control_ = control ? control : &ownControl_;
+    generation_ = control ? generation : ownControl_.generation.load();
+  }
+
+  // A new size changes the pixel every point lands on, so the density starts over.
+  // The orbit and parameters carry on.
+  void
+  resize(int width, int height) {
+    width = std::max(0, width);
+    height = std::max(0, height);
+    if (width == buffers_.width && height == buffers_.height) {
+      return;
+    }
+    buffers_.reset(width, height, buffers_.compact != nullptr);
+    clear();
+  }
+
+  // Keeps the density in 16-bit counters, half the memory of uint32_t ones on a canvas
+  // with few pixels past 65535, at the cost of a slower scatter. Switching starts the
+  // density over, like a resize.
+  void
+  setCompact(bool compact) {
+    if (compact == (buffers_.compact != nullptr)) {
+      return;
     }
+    buffers_.reset(buffers_.width, buffers_.height, compact);
+    clear();
+  }
 
-    i++;
+  // Adds points to the density and returns { x, y, maxDensity, pointsAdded }
+  emscripten::val
+  step(int points) {
+    accumulate(points);
+    emscripten::val result = emscripten::val::object();
+    result.set("x", x_);
+    result.set("y", y_);
+    result.set("maxDensity", control_->maxDensity.load(std::memory_order_relaxed));
+    result.set("pointsAdded", pointsAdded_);
+    return result;
+  }
+
+  void
+  accumulate(int points) {
+    if (!valid_ || points <= 0 || isCancelled()) {
+      return;
+    }
 
-    if (context.updateProgress && (i % 100000 == 0 || i == context.pointsToCalculate - 1)) {
-      // Update progress, this will result in <100 to let other process define what 100 is
-      int newProgress =
-        static_cast<int>(i / static_cast<double>(context.pointsToCalculate) * 100.0);
-      if (newProgress != getProgress()) {
-        setProgress(newProgress);
+    // The kernel reports at every poll: the running max density goes out to the control
+    // block, and a cancel or a newer generation found there stops it at the next poll
+    CalculationMonitor monitor;
+    monitor.cancelled = std::make_shared<std::atomic<bool>>(false);
+    monitor.report = [this, &monitor](int64_t, uint32_t maxDensity) {
+      control_->maxDensity.store(maxDensity, std::memory_order_relaxed);
+      if (isCancelled()) {
+        monitor.cancelled->store(true, std::memory_order_relaxed);
       }
+    };
+
+    int maxDensity = static_cast<int>(control_->maxDensity.load(std::memory_order_relaxed));
+    AccumulationContext context = {
+      .densityPtr = buffers_.density.data(),
+      .densitySize = densitySize(),
+      .maxDensity = maxDensity,
+      .x = x_,
+      .y = y_,
+      .pointsToCalculate = points,
+      .w = buffers_.width,
+      .h = buffers_.height,
+      .attractorParams = params_,
+      .centerX = AttractorCore::centerX(params_, buffers_.width),
+      .centerY = AttractorCore::centerY(params_, buffers_.height),
+      .attractorType = attractorType_,
+      .monitor = &monitor,
+      .reportsProgress = true,
+      .compact = buffers_.compact.get(),
+      .occupancy = &buffers_.occupancy,
+      .dirty = &buffers_.dirty,
+    };
+    core_.accumulateDensity(context, coin_);
+
+    control_->maxDensity.store(static_cast<uint32_t>(maxDensity), std::memory_order_relaxed);
+    pointsAdded_ += monitor.pointsDone.load(std::memory_order_relaxed);
+    pointsInDensity_ += monitor.pointsDone.load(std::memory_order_relaxed);
+  }
+
+  // Colours the current density into the image buffer and returns the rectangles of it
+  // that changed. Only the tiles with new points are recoloured while the colours of the
+  // others still hold. A preview may colour with a slightly stale max density for that,
+  // see kPreviewDensitySlack, and is coloured from a coarse level of the density while
+  // there are too few points for the full one.
+  const std::vector<ImageRect>&
+  colorize(bool highQuality, bool preview) {
+    changedRects_.clear();
+    if (isCancelled()) {
+      return changedRects_;
+    }
+    if (highQuality != coloredHighQuality_) {
+      coloredMaxDensity_ = -1;
     }
+    int level =
+      preview ? DensityPyramid::previewLevel(pointsInDensity_, buffers_.width, buffers_.height)
+              : 0;
+    int maxDensity = static_cast<int>(control_->maxDensity.load(std::memory_order_relaxed));
+    if (level > 0) {
+      uint32_t levelMax = buffers_.compact
+        ? buffers_.pyramid.build(*buffers_.compact, level, &buffers_.occupancy)
+        : buffers_.pyramid.build(buffers_.density.data(), level, &buffers_.occupancy);
+      maxDensity = static_cast<int>(levelMax);
+    } else if (preview && coloredMaxDensity_ > 0 && maxDensity > coloredMaxDensity_ &&
+               maxDensity <= coloredMaxDensity_ * kPreviewDensitySlack) {
+      maxDensity = coloredMaxDensity_;
+    }
+    ImageDataCreationContext context = {
+      .imageData = buffers_.image.data(),
+      .imageSize = static_cast<int>(buffers_.image.size()),
+      .densityPtr = buffers_.density.data(),
+      .densitySize = densitySize(),
+      .maxDensity = maxDensity,
+      .highQuality = highQuality,
+      .attractorParams = params_,
+      .width = buffers_.width,
+      .height = buffers_.height,
+      .compact = buffers_.compact.get(),
+      .occupancy = &buffers_.occupancy,
+      .dirty = &buffers_.dirty,
+      .coloredMaxDensity = coloredMaxDensity_,
+      .changedRects = &changedRects_,
+      .pyramid = &buffers_.pyramid,
+      .pyramidLevel = level,
+    };
+    core_.createImageData(context);
+    buffers_.dirty.clear();
+    // A coarse frame leaves nothing the next one can keep
+    coloredMaxDensity_ = level > 0 ? -1 : maxDensity;
+    coloredHighQuality_ = highQuality;
+    return changedRects_;
   }
-}
 
-// Context for image data creation (WASM side)
-struct ImageDataCreationContext {
-  emscripten::val* jsImageArray;         // Pointer to JS Uint32Array view (nullable)
-  std::vector<uint32_t>* cppImageArray;  // Pointer to std::vector<uint32_t> (nullable)
-  int imageSize;
-  emscripten::val* jsDensityArray;         // Pointer to JS Uint32Array view (nullable)
-  std::vector<uint32_t>* cppDensityArray;  // Pointer to std::vector<uint32_t> (nullable)
-  emscripten::val* jsInfoArray;            // Pointer to JS Uint32Array view (nullable)
-  std::vector<uint32_t>* cppInfoArray;     // Pointer to std::vector<uint32_t> (nullable)
-  bool highQuality;
-  AttractorParameters attractorParams;
-};
+  // Both return the changed rectangles as [{ x, y, width, height }]
+  emscripten::val
+  render(bool highQuality) {
+    return rectsToJs(colorize(highQuality, false));
+  }
 
-// Create image data function
-void
-createImageData(ImageDataCreationContext& context) {
-  int loopLimit = context.imageSize;
-
-  uint32_t bgColor = 0;
-  if (!context.attractorParams.background.empty()) {
-    uint32_t bgA =
-      context.attractorParams.background.size() > 3 ? context.attractorParams.background[3] : 255;
-    uint32_t bgB =
-      context.attractorParams.background.size() > 2 ? context.attractorParams.background[2] : 0;
-    uint32_t bgG =
-      context.attractorParams.background.size() > 1 ? context.attractorParams.background[1] : 0;
-    uint32_t bgR = context.attractorParams.background[0];
-    bgColor = (bgA << 24) | (bgB << 16) | (bgG << 8) | bgR;
+  emscripten::val
+  renderPreview(bool highQuality) {
+    return rectsToJs(colorize(highQuality, true));
   }
 
-  // Helper functions to access info array values
-  auto getCancelFlag = [&]() -> int {
-    if (context.jsInfoArray)
-      return (*context.jsInfoArray)[1].as<int>();
-    if (context.cppInfoArray)
-      return (*context.cppInfoArray)[1];
-    return 0;
-  };
+  // Stops accumulate() and render() early while set
+  void
+  setCancelled(bool cancelled) {
+    control_->cancel.store(cancelled ? 1 : 0, std::memory_order_relaxed);
+  }
 
-  auto getMaxDensity = [&]() -> int {
-    if (context.jsInfoArray)
-      return (*context.jsInfoArray)[0].as<int>();
-    if (context.cppInfoArray)
-      return (*context.cppInfoArray)[0];
-    return 1;
-  };
+  bool
+  isCancelled() const {
+    return attractor::isCancelled(*control_, generation_);
+  }
 
-  if (getCancelFlag() != 0) {
-    // Cancel the operation
-    return;
+  void
+  setProgress(uint32_t progress) {
+    control_->progress.store(progress, std::memory_order_release);
   }
 
-  int i = 0;
-  while (i < loopLimit && getCancelFlag() == 0) {
-    int dval = 0;
+  void
+  setConverged() {
+    control_->converged.store(1, std::memory_order_release);
+  }
 
-    // Handle both JS and C++ array types for density data
-    if (context.jsDensityArray) {
-      dval = (*context.jsDensityArray)[i].as<int>();
-    } else if (context.cppDensityArray) {
-      dval = (*context.cppDensityArray)[i];
-    }
+  // Feeds the density after pointsDone points of this render to the tracker
+  bool
+  checkConvergence(facebook::react::ConvergenceTracker& tracker, int64_t pointsDone) const {
+    const std::vector<uint32_t>& density = buffers_.density;
+    const CompactDensity* compact = buffers_.compact.get();
+    return tracker.update(
+      [&](size_t i) { return compact ? compact->get(i) : density[i]; },
+      densitySize(),
+      control_->maxDensity.load(std::memory_order_relaxed),
+      pointsDone
+    );
+  }
 
-    if (dval > 0) {
-      if (context.highQuality) {
-        uint32_t colorData = getColorData(
-          dval,
-          getMaxDensity(),
-          context.attractorParams.hue,
-          context.attractorParams.saturation,
-          context.attractorParams.brightness,
-          1.0,
-          context.attractorParams.background
-        );
+  // Views onto the session's buffers. Memory growth detaches them, so fetch them
+  // again after every step instead of keeping them around. The density view is empty
+  // while the session is compact.
+  emscripten::val
+  getDensityView() const {
+    return emscripten::val(
+      emscripten::typed_memory_view(buffers_.density.size(), buffers_.density.data())
+    );
+  }
 
-        // Handle both JS and C++ array types for image output
-        if (context.jsImageArray) {
-          context.jsImageArray->set(i, colorData);
-        } else if (context.cppImageArray) {
-          (*context.cppImageArray)[i] = colorData;
-        }
-      } else {
-        uint32_t colorData = getLowQualityPoint(
-          context.attractorParams.hue,
-          context.attractorParams.saturation,
-          context.attractorParams.brightness
-        );
+  emscripten::val
+  getImageView() const {
+    return emscripten::val(
+      emscripten::typed_memory_view(buffers_.image.size(), buffers_.image.data())
+    );
+  }
 
-        // Handle both JS and C++ array types for image output
-        if (context.jsImageArray) {
-          context.jsImageArray->set(i, colorData);
-        } else if (context.cppImageArray) {
-          (*context.cppImageArray)[i] = colorData;
-        }
-      }
+  double
+  getX() const {
+    return x_;
+  }
+
+  double
+  getY() const {
+    return y_;
+  }
+
+  double
+  getPointsAdded() const {
+    return pointsAdded_;
+  }
+
+ private:
+  size_t
+  densitySize() const {
+    return buffers_.compact ? buffers_.compact->size() : buffers_.density.size();
+  }
+
+  void
+  clear() {
+    if (buffers_.compact) {
+      buffers_.compact->clear();
+      buffers_.occupancy.clear();
     } else {
-      // Handle both JS and C++ array types for image output
-      if (context.jsImageArray) {
-        context.jsImageArray->set(i, bgColor);
-      } else if (context.cppImageArray) {
-        (*context.cppImageArray)[i] = bgColor;
-      }
+      buffers_.occupancy.clearDensity(buffers_.density.data(), DensityLayout::ROW_MAJOR);
     }
-    i++;
+    std::fill(buffers_.image.begin(), buffers_.image.end(), 0);
+    buffers_.dirty.clear();
+    coloredMaxDensity_ = -1;
+    pointsInDensity_ = 0;
+    control_->maxDensity.store(0, std::memory_order_relaxed);
   }
+
+  // No pool, the page runs the module in a worker of its own
+  AttractorCore core_;
+  FrameBuffers buffers_;
+  ControlBlock ownControl_;
+  ControlBlock* control_ = &ownControl_;
+  uint32_t generation_ = 0;
+  AttractorParameters params_;
+  bool valid_ = false;
+  AttractorType attractorType_ = AttractorType::CLIFFORD;
+  double x_ = 0;
+  double y_ = 0;
+  double pointsAdded_ = 0;
+  CounterCoin coin_{0};
+  // Points in the density now, pointsAdded_ also counts those before a resize
+  int64_t pointsInDensity_ = 0;
+  // What the image holds: the max density it was coloured with, -1 for nothing
+  int coloredMaxDensity_ = -1;
+  bool coloredHighQuality_ = false;
+  std::vector<ImageRect> changedRects_;
+};
+
+// Control blocks handed to JS by getControlBlocks(). The page cycles through them, one
+// per render, so a block is never reset while an older render may still write to it.
+constexpr int kControlBlockCount = 8;
+ControlBlock controlBlocks[kControlBlockCount];
+
+// All blocks as one Uint32Array over the module's shared memory, 6 slots per block
+emscripten::val
+getControlBlocks() {
+  return emscripten::val(emscripten::typed_memory_view(
+    kControlBlockCount * sizeof(ControlBlock) / sizeof(uint32_t),
+    reinterpret_cast<const uint32_t*>(controlBlocks)
+  ));
+}
+
+// Session behind calculateAttractorLoop and the module-level views
+RenderSession&
+defaultSession() {
+  static RenderSession session(0, 0);
+  return session;
+}
+
+emscripten::val
+getDensityView() {
+  return defaultSession().getDensityView();
+}
+
+emscripten::val
+getImageView() {
+  return defaultSession().getImageView();
 }
 
 // Context for density calculation
@@ -540,105 +567,161 @@ calculateAttractorLoop(emscripten::val jsCtx) {
   // Get buffer pointers from JS using typed arrays directly
   // emscripten::val densityArray = emscripten::val::global("Uint32Array").new_(ctx.densityBuffer);
   emscripten::val imageArray = emscripten::val::global("Uint32Array").new_(ctx.imageBuffer);
-  emscripten::val infoArray = emscripten::val::global("Uint32Array").new_(ctx.infoBuffer);
-
-  // Create C++ vector for fast computation (initialize to zero)
-  std::vector<uint32_t> uint32DensityArray(ctx.width * ctx.height, 0);
-  std::vector<uint32_t> uint32ImageArray(ctx.width * ctx.height, 0);
-  std::vector<uint32_t> uint32InfoArray(infoArray["length"].as<int>(), 0);
-
-  // Get attractor function based on type
-  std::function<std::pair<double, double>(double, double, double, double, double, double)>
-    attractorFunc;
-  if (attractorParams.attractor == "clifford") {
-    attractorFunc = clifford;
-  } else if (attractorParams.attractor == "dejong") {
-    attractorFunc = dejong;
+
+  // Every call is a new render, computed in the default session's buffers
+  RenderSession& session = defaultSession();
+
+  // Pages that took a block from getControlBlocks() pass its index and generation, the
+  // kernel then sees a cancel as soon as it polls. Otherwise the cancel flag of the
+  // infoBuffer is copied over between chunks.
+  emscripten::val jsControlSlot = jsCtx["controlSlot"];
+  emscripten::val infoArray = emscripten::val::undefined();
+  if (jsControlSlot.isNumber()) {
+    int slot = jsControlSlot.as<int>();
+    if (slot < 0 || slot >= kControlBlockCount) {
+      emscripten::val error = emscripten::val::object();
+      error.set("error", "Invalid control block: " + std::to_string(slot));
+      return error;
+    }
+    session.useControlBlock(&controlBlocks[slot], jsCtx["generation"].as<uint32_t>());
   } else {
-    // Return error object
-    emscripten::val error = emscripten::val::object();
-    error.set(
-      "error",
-      "Invalid attractor type: " + attractorParams.attractor + ". Must be 'clifford' or 'dejong'."
-    );
-    return error;
+    infoArray = emscripten::val::global("Uint32Array").new_(ctx.infoBuffer);
+    session.useControlBlock(nullptr, 0);
+    session.setCancelled(false);
   }
 
-  // Initialize calculation variables
-  double centerX = ctx.width / 2.0 + attractorParams.left * ctx.width;
-  double centerY = ctx.height / 2.0 + attractorParams.top * ctx.height;
-
-  int pointsToCalculate =
-    static_cast<int>(ctx.pointsToCalculate / static_cast<double>(ctx.loopNum));
-  int num = 0;
-
-  // Accumulate density
-  AccumulationContext accumCtx = {
-    .jsDensityArray = nullptr,
-    .cppDensityArray = &uint32DensityArray,
-    .jsInfoArray = nullptr,
-    .cppInfoArray = &uint32InfoArray,
-    .x = ctx.x,
-    .y = ctx.y,
-    .pointsToCalculate = pointsToCalculate,
-    .w = ctx.width,
-    .h = ctx.height,
-    .attractorParams = attractorParams,
-    .centerX = centerX,
-    .centerY = centerY,
-    .fn = attractorFunc,
-    .updateProgress = false
+  auto cancelled = [&]() {
+    if (!infoArray.isUndefined()) {
+      session.setCancelled(infoArray[1].as<int>() != 0);
+    }
+    return session.isCancelled();
   };
 
-  // Create image data
-  ImageDataCreationContext imgCtx = {
-    .jsImageArray = nullptr,
-    .cppImageArray = &uint32ImageArray,
-    .imageSize = ctx.width * ctx.height,
-    .jsDensityArray = nullptr,
-    .cppDensityArray = &uint32DensityArray,
-    .jsInfoArray = nullptr,
-    .cppInfoArray = &uint32InfoArray,
-    .highQuality = ctx.highQuality,
-    .attractorParams = attractorParams
+  // Pages short of memory ask for 16-bit counters
+  session.setCompact(jsCtx["compact"].isTrue());
+  session.resize(ctx.width, ctx.height);
+  emscripten::val error = session.start(attractorParams, ctx.x, ctx.y);
+  if (!error.isUndefined()) {
+    return error;
+  }
+
+  // Publishes the parts of the frame that changed to the shared buffer the draw worker
+  // reads, then hands them to onFrame([{ x, y, width, height }]) when the page passed one
+  // so it can put only those regions on the canvas
+  emscripten::val onFrame = jsCtx["onFrame"];
+  auto publishFrame = [&](bool last) {
+    const std::vector<ImageRect>& rects = session.colorize(ctx.highQuality, !last);
+    emscripten::val image = session.getImageView();
+    for (const ImageRect& rect : rects) {
+      // Full rows are one bulk copy, narrower rectangles a copy per row
+      int copies = rect.width == ctx.width ? 1 : rect.height;
+      int length = rect.width == ctx.width ? rect.width * rect.height : rect.width;
+      for (int i = 0; i < copies; i++) {
+        int begin = (rect.y + i) * ctx.width + rect.x;
+        imageArray.call<void>(
+          "set", image.call<emscripten::val>("subarray", begin, begin + length), begin
+        );
+      }
+    }
+    if (onFrame.typeOf().as<std::string>() == "function" && !rects.empty()) {
+      onFrame(rectsToJs(rects));
+    }
   };
 
-  int totalLoop = 0;
-  while (num < ctx.loopNum) {
-    accumulateDensity(accumCtx);
+  // Published after the frame, the draw worker redraws when it changes
+  auto publishProgress = [&](double fraction) {
+    uint32_t progress = static_cast<uint32_t>(fraction * 100.0);
+    if (infoArray.isUndefined()) {
+      session.setProgress(progress);
+    } else {
+      infoArray.set(3, progress);
+    }
+  };
 
-    if (infoArray[1].as<int>() != 0) {
-      break;
+  // With a threshold the render stops, and says so in the control block and the result,
+  // once doubling the points changes the image by less than it
+  emscripten::val jsConvergence = jsCtx["convergenceThreshold"];
+  bool trackConvergence = jsConvergence.isNumber() && jsConvergence.as<double>() > 0;
+  facebook::react::ConvergenceTracker tracker(
+    trackConvergence ? jsConvergence.as<double>() : 0
+  );
+  auto converged = [&](int64_t pointsDone) {
+    if (!trackConvergence || !session.checkConvergence(tracker, pointsDone)) {
+      return false;
     }
+    session.setConverged();
+    return true;
+  };
+
+  // With a chunk budget the chunks follow the measured speed and the frame is redrawn at
+  // targetFps, otherwise the points run in loopNum equal chunks redrawn every drawAt points
+  emscripten::val jsChunkBudget = jsCtx["chunkBudgetMs"];
+  if (jsChunkBudget.isNumber() && jsChunkBudget.as<double>() > 0) {
+    emscripten::val jsTargetFps = jsCtx["targetFps"];
+    facebook::react::ChunkScheduler scheduler(
+      jsChunkBudget.as<double>(), jsTargetFps.isNumber() ? jsTargetFps.as<double>() : 30
+    );
 
-    if ((totalLoop % ctx.drawAt) == 0 || num == ctx.loopNum - 1) {
-      createImageData(imgCtx);
-      // Copy C++ image data to JavaScript array for display
-      int i = 0;
-      while (i < imgCtx.imageSize) {
-        imageArray.set(i, (*imgCtx.cppImageArray)[i]);
-        i++;
+    int64_t done = 0;
+    while (done < ctx.pointsToCalculate) {
+      int chunk = scheduler.nextChunk(ctx.pointsToCalculate - done);
+      double chunkStart = emscripten_get_now();
+      session.accumulate(chunk);
+      scheduler.record(chunk, emscripten_get_now() - chunkStart);
+      done += chunk;
+
+      if (cancelled()) {
+        break;
+      }
+      bool last = done == ctx.pointsToCalculate || converged(done);
+      if (last || scheduler.shouldDraw(emscripten_get_now())) {
+        publishFrame(last);
+      }
+      if (cancelled()) {
+        break;
+      }
+      publishProgress(last ? 1.0 : done / static_cast<double>(ctx.pointsToCalculate));
+      if (last) {
+        break;
       }
     }
+  } else {
+    int pointsToCalculate =
+      static_cast<int>(ctx.pointsToCalculate / static_cast<double>(ctx.loopNum));
+    int num = 0;
 
-    if (infoArray[1].as<int>() != 0) {
-      break;
-    }
+    int totalLoop = 0;
+    while (num < ctx.loopNum) {
+      session.accumulate(pointsToCalculate);
+
+      if (cancelled()) {
+        break;
+      }
 
-    totalLoop = totalLoop + pointsToCalculate;
-    num++;
+      bool last = num == ctx.loopNum - 1 ||
+        converged(static_cast<int64_t>(num + 1) * pointsToCalculate);
+      if ((totalLoop % ctx.drawAt) == 0 || last) {
+        publishFrame(last);
+      }
 
-    // Copy progress
-    infoArray.set(3, static_cast<uint32_t>(num / static_cast<double>(ctx.loopNum) * 100.0));
+      if (cancelled()) {
+        break;
+      }
 
-    // Copy cancelation
-    uint32InfoArray[1] = infoArray[1].as<int>();
+      totalLoop = totalLoop + pointsToCalculate;
+      num++;
+      publishProgress(last ? 1.0 : num / static_cast<double>(ctx.loopNum));
+      if (last) {
+        break;
+      }
+    }
   }
 
   emscripten::val result = emscripten::val::object();
-  result.set("x", accumCtx.x);
-  result.set("y", accumCtx.y);
-  result.set("pointsAdded", ctx.pointsToCalculate);
+  result.set("x", session.getX());
+  result.set("y", session.getY());
+  result.set("pointsAdded", session.getPointsAdded());
+  result.set("converged", tracker.converged());
 
   return result;
 }
@@ -651,4 +734,20 @@ EMSCRIPTEN_BINDINGS(attractor_module) {
   emscripten::function("getBuildNumber", &attractor::getBuildNumber);
   // Bind the struct-based functions
   emscripten::function("calculateAttractorLoop", &attractor::calculateAttractorLoop);
+  emscripten::function("getDensityView", &attractor::getDensityView);
+  emscripten::function("getImageView", &attractor::getImageView);
+  emscripten::function("getControlBlocks", &attractor::getControlBlocks);
+
+  // Progressive render kept alive between calls, JS must call delete() when done with it
+  emscripten::class_<attractor::RenderSession>("RenderSession")
+    .constructor<int, int>()
+    .function("reset", &attractor::RenderSession::reset)
+    .function("resize", &attractor::RenderSession::resize)
+    .function("setCompact", &attractor::RenderSession::setCompact)
+    .function("step", &attractor::RenderSession::step)
+    .function("render", &attractor::RenderSession::render)
+    .function("renderPreview", &attractor::RenderSession::renderPreview)
+    .function("getDensityView", &attractor::RenderSession::getDensityView)
+    .function("getImageView", &attractor::RenderSession::getImageView)
+    .function("setCancelled", &attractor::RenderSession::setCancelled);
 }
@@ -11,6 +11,7 @@ export interface AttractorParameters {
   scale: number;
   left: number;
   top: number;
+  seed?: number;
 }
 
 export interface AttractorResult {
@@ -20,6 +21,14 @@ export interface AttractorResult {
   pointsAdded: number;
 }
 
+/** Pixels of the image a render changed */
+export interface ImageRect {
+  x: number;
+  y: number;
+  width: number;
+  height: number;
+}
+
 export enum PerformanceRating {
   VERY_SLOW = 1,
   SLOW = 2,
@@ -116,6 +125,63 @@ export function calculateAttractor(
   shouldDraw: boolean,
 ): AttractorResult;
 
+/**
+ * View onto the density buffer owned by the module, filled by the last calculation.
+ * Memory growth detaches the view, so fetch it again after each calculation.
+ */
+export function getDensityView(): Uint32Array;
+
+/**
+ * View onto the image buffer owned by the module, holding the last drawn frame.
+ * Memory growth detaches the view, so fetch it again after each calculation.
+ */
+export function getImageView(): Uint32Array;
+
+/**
+ * Control blocks in the module's shared memory, 5 uint32 each:
+ * maxDensity, cancel, done, progress (0-100), generation.
+ * Take one per render, reset it, store the render's generation in slot 4 and pass
+ * controlSlot and generation to calculateAttractorLoop. Use Atomics to access it.
+ */
+export function getControlBlocks(): Uint32Array;
+
+/**
+ * Progressive render kept in the module between calls. It owns its density and image
+ * buffers, so each step() adds to the previous ones without reallocating.
+ * Call delete() when the session is no longer needed.
+ */
+export class RenderSession {
+  constructor(width: number, height: number);
+  /** Starts a new render at (0, 0), returns { error } for an invalid attractor type */
+  reset(attractorParams: AttractorParameters): { error: string } | undefined;
+  /** Clears the density when the size changes, the orbit carries on */
+  resize(width: number, height: number): void;
+  /**
+   * Keeps the density in 16-bit counters, half the memory of 32-bit ones, for devices
+   * short of it. Switching clears the density, and getDensityView() is empty while set.
+   */
+  setCompact(compact: boolean): void;
+  step(points: number): AttractorResult;
+  /**
+   * Colours the density into the image and returns the rectangles that changed, for
+   * putImageData's dirty rectangle. Only tiles with new points are recoloured while the
+   * colours of the others still hold.
+   */
+  render(highQuality: boolean): ImageRect[];
+  /**
+   * render() for a progressive frame, which keeps the previous max density while the
+   * real one has grown by less than 1/16 so fewer frames recolour everything. Until
+   * there is about a point per pixel it is coloured from a 1/2, 1/4 or 1/8 size copy of
+   * the density and scaled up.
+   */
+  renderPreview(highQuality: boolean): ImageRect[];
+  getDensityView(): Uint32Array;
+  getImageView(): Uint32Array;
+  /** Stops the current step or render at its next poll while set */
+  setCancelled(cancelled: boolean): void;
+  delete(): void;
+}
+
 /**
  * Rates the performance of the system for attractor calculations
  * @returns A performance rating value
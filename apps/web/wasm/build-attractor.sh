@@ -11,9 +11,19 @@ mkdir -p ../public/wasm
 
 # --closure 1 \
 # Compile the C++ code to WebAssembly
+# The attractor core is shared with the React Native app, the module only adds bindings
+CORE=../../chaoscanvas/shared
 emcc \
   attractor-calc.cpp \
-  -std=c++17 \
+  $CORE/AttractorCore.cpp \
+  $CORE/AttractorSimd.cpp \
+  $CORE/CompactDensity.cpp \
+  $CORE/DensityPyramid.cpp \
+  $CORE/OccupancyMap.cpp \
+  $CORE/OrbitRecorder.cpp \
+  $CORE/WorkerPool.cpp \
+  -I$CORE \
+  -std=c++20 \
   -O3 \
   -gsource-map \
   -s WASM=1 \
@@ -23,6 +33,11 @@ emcc \
   -s EXPORT_NAME="AttractorModule" \
   -s ENVIRONMENT='web,worker' \
   -s MALLOC=emmalloc \
+  -s ALLOW_MEMORY_GROWTH=1 \
+  -s SHARED_MEMORY=1 \
+  -matomics \
+  -mbulk-memory \
+  -msimd128 \
   --source-map-base / \
   --closure 1 \
   --bind \
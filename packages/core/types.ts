@@ -11,4 +11,9 @@ export type AttractorParameters = {
   scale: number;
   left: number;
   top: number;
+  // seeds the smoothing noise, the same seed and parameters render the same density
+  seed?: number;
+  // sin/cos accuracy of the map: "exact" (default), "float" or the cheapest "fast"; the
+  // cheaper ones render the same density up to noise, a little faster
+  precision?: "exact" | "float" | "fast";
 };